@@ -0,0 +1,315 @@
+/*
+  ==============================================================================
+
+    AllocationTracker.cpp
+
+  ==============================================================================
+*/
+
+#include "AllocationTracker.h"
+
+#if TESTDISTORTION_TRACK_ALLOCATIONS
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_WINDOWS
+ #include <malloc.h>
+ #if defined(_DEBUG)
+  #include <crtdbg.h>
+ #endif
+#else
+ #include <pthread.h>
+#endif
+
+#if JUCE_MAC
+ #include <malloc/malloc.h>
+ #include <mach/mach.h>
+#endif
+
+#if JUCE_LINUX
+extern "C"
+{
+    void* __libc_malloc(std::size_t);
+    void* __libc_calloc(std::size_t, std::size_t);
+    void* __libc_realloc(void*, std::size_t);
+    void __libc_free(void*);
+}
+#endif
+
+namespace
+{
+    std::atomic<juce::int64> realtimeAllocations{ 0 };
+    std::atomic<bool> abortOnAllocation{ true };
+
+    // The realtime depth of the calling thread. The malloc hooks read it on
+    // every allocation in the process, from threads that may never have
+    // touched it, so on macOS and Linux it lives in a pthread key: the
+    // first touch of a thread_local there can itself call malloc.
+   #if JUCE_WINDOWS
+    thread_local int realtimeDepth = 0;
+
+    int getRealtimeDepth() noexcept { return realtimeDepth; }
+    void setRealtimeDepth(int depth) noexcept { realtimeDepth = depth; }
+   #else
+    pthread_key_t depthKey;
+    std::atomic<bool> depthKeyReady{ false };
+
+    int getRealtimeDepth() noexcept
+    {
+        if (! depthKeyReady.load(std::memory_order_acquire))
+            return 0;
+        return static_cast<int>(reinterpret_cast<std::intptr_t>(pthread_getspecific(depthKey)));
+    }
+
+    void setRealtimeDepth(int depth) noexcept
+    {
+        if (depthKeyReady.load(std::memory_order_acquire))
+            pthread_setspecific(depthKey, reinterpret_cast<void*>(static_cast<std::intptr_t>(depth)));
+    }
+   #endif
+
+    void checkAllocation(std::size_t size) noexcept
+    {
+        auto depth = getRealtimeDepth();
+        if (depth == 0)
+            return;
+
+        realtimeAllocations.fetch_add(1, std::memory_order_relaxed);
+
+        if (abortOnAllocation.load(std::memory_order_relaxed))
+        {
+            // fprintf may allocate, so leave the section first rather than
+            // come back in here. Nothing else may allocate, so no String or DBG.
+            setRealtimeDepth(0);
+            std::fprintf(stderr, "AllocationTracker: %zu byte allocation inside processBlock\n", size);
+            std::fflush(stderr);
+            std::abort();
+        }
+    }
+
+    // operator new checks the size itself, then leaves the section while
+    // the C allocator runs, so the malloc hooks don't count it again.
+    struct ScopedForwarding
+    {
+        ScopedForwarding() noexcept : depth(getRealtimeDepth()) { if (depth != 0) setRealtimeDepth(0); }
+        ~ScopedForwarding() noexcept { if (depth != 0) setRealtimeDepth(depth); }
+
+        int depth;
+    };
+
+    void* allocateRaw(std::size_t size, std::size_t alignment) noexcept
+    {
+        ScopedForwarding forwarding;
+        size = size != 0 ? size : 1;
+
+        if (alignment <= alignof(std::max_align_t))
+            return std::malloc(size);
+
+       #if JUCE_WINDOWS
+        return _aligned_malloc(size, alignment);
+       #else
+        void* ptr = nullptr;
+        return posix_memalign(&ptr, alignment, size) == 0 ? ptr : nullptr;
+       #endif
+    }
+
+    void freeRaw(void* ptr, std::size_t alignment) noexcept
+    {
+       #if JUCE_WINDOWS
+        if (alignment > alignof(std::max_align_t))
+        {
+            _aligned_free(ptr);
+            return;
+        }
+       #else
+        juce::ignoreUnused(alignment);
+       #endif
+
+        std::free(ptr);
+    }
+
+    void* allocate(std::size_t size, std::size_t alignment = 0)
+    {
+        checkAllocation(size);
+
+        if (auto* ptr = allocateRaw(size, alignment))
+            return ptr;
+
+        throw std::bad_alloc();
+    }
+
+    void* allocateNoThrow(std::size_t size, std::size_t alignment = 0) noexcept
+    {
+        checkAllocation(size);
+        return allocateRaw(size, alignment);
+    }
+
+    //==============================================================================
+    // malloc and friends. HeapBlock, and so AudioBuffer, allocate through
+    // these rather than operator new.
+   #if JUCE_WINDOWS && defined(_DEBUG)
+    _CRT_ALLOC_HOOK previousHook = nullptr;
+
+    int __cdecl crtAllocHook(int allocType, void* userData, std::size_t size, int blockType,
+                             long requestNumber, const unsigned char* fileName, int lineNumber)
+    {
+        // The CRT's own blocks (stdio buffers and the like) are left alone.
+        if (blockType != _CRT_BLOCK && allocType != _HOOK_FREE)
+            checkAllocation(size);
+
+        return previousHook != nullptr ? previousHook(allocType, userData, size, blockType, requestNumber, fileName, lineNumber)
+                                       : TRUE;
+    }
+
+    void installMallocHooks() noexcept
+    {
+        previousHook = _CrtSetAllocHook(crtAllocHook);
+    }
+   #elif JUCE_MAC
+    // The default zone's table is swapped for one that checks first.
+    malloc_zone_t originalZone;
+
+    void* zoneMalloc(malloc_zone_t* zone, std::size_t size)
+    {
+        checkAllocation(size);
+        return originalZone.malloc(zone, size);
+    }
+
+    void* zoneCalloc(malloc_zone_t* zone, std::size_t count, std::size_t size)
+    {
+        checkAllocation(count * size);
+        return originalZone.calloc(zone, count, size);
+    }
+
+    void* zoneValloc(malloc_zone_t* zone, std::size_t size)
+    {
+        checkAllocation(size);
+        return originalZone.valloc(zone, size);
+    }
+
+    void* zoneRealloc(malloc_zone_t* zone, void* ptr, std::size_t size)
+    {
+        checkAllocation(size);
+        return originalZone.realloc(zone, ptr, size);
+    }
+
+    void* zoneMemalign(malloc_zone_t* zone, std::size_t alignment, std::size_t size)
+    {
+        checkAllocation(size);
+        return originalZone.memalign(zone, alignment, size);
+    }
+
+    void installMallocHooks() noexcept
+    {
+        auto* zone = malloc_default_zone();
+        originalZone = *zone;
+
+        // The zone table sits in read-only memory.
+        auto address = reinterpret_cast<vm_address_t>(zone);
+        vm_protect(mach_task_self(), address, sizeof(malloc_zone_t), 0, VM_PROT_READ | VM_PROT_WRITE);
+
+        zone->malloc = zoneMalloc;
+        zone->calloc = zoneCalloc;
+        zone->valloc = zoneValloc;
+        zone->realloc = zoneRealloc;
+        if (zone->version >= 5)
+            zone->memalign = zoneMemalign;
+
+        vm_protect(mach_task_self(), address, sizeof(malloc_zone_t), 0, VM_PROT_READ);
+    }
+   #else
+    // On Linux the definitions below interpose glibc's, which only works
+    // when this file is linked into the executable (the tools), not into a
+    // plugin the host dlopens.
+    void installMallocHooks() noexcept {}
+   #endif
+
+    struct HookInstaller
+    {
+        HookInstaller() noexcept
+        {
+           #if ! JUCE_WINDOWS
+            if (pthread_key_create(&depthKey, nullptr) == 0)
+                depthKeyReady.store(true, std::memory_order_release);
+           #endif
+
+            installMallocHooks();
+        }
+    };
+
+    const HookInstaller hookInstaller;
+}
+
+#if JUCE_LINUX
+extern "C"
+{
+    void* malloc(std::size_t size) noexcept
+    {
+        checkAllocation(size);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size) noexcept
+    {
+        checkAllocation(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, std::size_t size) noexcept
+    {
+        checkAllocation(size);
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void* ptr) noexcept
+    {
+        __libc_free(ptr);
+    }
+}
+#endif
+
+namespace AllocationTracker
+{
+    ScopedRealtimeSection::ScopedRealtimeSection() noexcept { setRealtimeDepth(getRealtimeDepth() + 1); }
+    ScopedRealtimeSection::~ScopedRealtimeSection() noexcept { setRealtimeDepth(getRealtimeDepth() - 1); }
+
+    juce::int64 getNumRealtimeAllocations() noexcept
+    {
+        return realtimeAllocations.load();
+    }
+
+    void setAbortOnRealtimeAllocation(bool shouldAbort) noexcept
+    {
+        abortOnAllocation.store(shouldAbort);
+    }
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocateNoThrow(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocateNoThrow(size); }
+
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocate(size, static_cast<std::size_t>(alignment)); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateNoThrow(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateNoThrow(size, static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept { freeRaw(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept { freeRaw(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept { freeRaw(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept { freeRaw(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept { freeRaw(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept { freeRaw(ptr, static_cast<std::size_t>(alignment)); }
+
+#endif
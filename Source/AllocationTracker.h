@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    AllocationTracker.h
+
+    Test-mode guard that fails loudly if the audio thread allocates.
+
+    Build with TESTDISTORTION_TRACK_ALLOCATIONS=1 (the Debug configuration
+    does) to replace the global operator new/delete, aligned forms included,
+    and to hook the C allocator that juce::HeapBlock (and so AudioBuffer)
+    uses. Any allocation made on a thread while it is inside a
+    ScopedRealtimeSection prints the size to stderr and aborts. With the flag
+    off, ScopedRealtimeSection is empty and nothing is replaced.
+
+    How malloc is hooked depends on the platform:
+      - Windows: a debug CRT allocation hook, so only in _DEBUG builds.
+      - macOS: the default malloc zone's functions are swapped.
+      - Linux: malloc, calloc, realloc and free are defined here and forward
+        to glibc, which interposes them only in an executable (the tools),
+        not in a plugin the host loads.
+    Elsewhere only operator new is caught. Benchmark --stress checks that
+    the guard fires before it starts.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef TESTDISTORTION_TRACK_ALLOCATIONS
+ #define TESTDISTORTION_TRACK_ALLOCATIONS 0
+#endif
+
+namespace AllocationTracker
+{
+   #if TESTDISTORTION_TRACK_ALLOCATIONS
+    struct ScopedRealtimeSection
+    {
+        ScopedRealtimeSection() noexcept;
+        ~ScopedRealtimeSection() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedRealtimeSection)
+    };
+
+    // Number of allocations seen inside a realtime section since startup.
+    // Only ever non-zero if abortOnRealtimeAllocation has been turned off.
+    juce::int64 getNumRealtimeAllocations() noexcept;
+
+    // Aborting is the default. Tools that want to count rather than crash
+    // can turn it off.
+    void setAbortOnRealtimeAllocation(bool shouldAbort) noexcept;
+   #else
+    struct ScopedRealtimeSection
+    {
+        ScopedRealtimeSection() noexcept {}
+    };
+
+    inline juce::int64 getNumRealtimeAllocations() noexcept { return 0; }
+    inline void setAbortOnRealtimeAllocation(bool) noexcept {}
+   #endif
+}
@@ -0,0 +1,365 @@
+/*
+  ==============================================================================
+
+    AntiderivativeShaper.cpp
+
+  ==============================================================================
+*/
+
+#include "AntiderivativeShaper.h"
+#include <numbers>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+    // Below this, divided differences fall back to evaluating the curve at the
+    // midpoint. Large enough that double rounding in F2 (which grows as x^2)
+    // stays well under float resolution up to +25 dB of input gain.
+    constexpr double tolerance = 1.0e-5;
+
+    //==========================================================================
+    // Each curve provides f, its first antiderivative F1 and its second
+    // antiderivative F2, all with F(0) = 0. The built-in curves are stateless;
+    // CustomCurveTable provides the same three from its tables.
+
+    struct ArcTanCurve
+    {
+        static constexpr double a = std::numbers::pi / 2;
+        static constexpr double c = 2 / std::numbers::pi;
+
+        static double f(double x) noexcept { return c * std::atan(a * x); }
+
+        static double F1(double x) noexcept
+        {
+            return c * (x * std::atan(a * x) - std::log1p(a * a * x * x) / (2 * a));
+        }
+
+        static double F2(double x) noexcept
+        {
+            return c * ((x * x / 2 - 1 / (2 * a * a)) * std::atan(a * x)
+                - x * std::log1p(a * a * x * x) / (2 * a)
+                + x / (2 * a));
+        }
+    };
+
+    struct HypTanCurve
+    {
+        static constexpr double ln2 = std::numbers::ln2;
+
+        static double f(double x) noexcept { return std::tanh(x); }
+
+        // log(cosh(x)), written so it neither overflows nor cancels.
+        static double F1(double x) noexcept
+        {
+            auto ax = std::abs(x);
+            return ax + std::log1p(std::exp(-2 * ax)) - ln2;
+        }
+
+        // For x >= 0, F2(x) = x^2/2 - x ln2 + (Li2(-e^-2x) + pi^2/12) / 2.
+        // With z = log(1 + e^-2x), Landen's identity gives
+        // Li2(-e^-2x) = -Li2(1 - e^-z) - z^2/2, and Li2(1 - e^-z) has a fast
+        // Bernoulli series for z <= ln2 (truncation error below 4e-15).
+        static double F2(double x) noexcept
+        {
+            auto ax = std::abs(x);
+            auto z = std::log1p(std::exp(-2 * ax));
+            auto z2 = z * z;
+            auto series = z * (1.0 + z * (-1.0 / 4 + z * (1.0 / 36 + z2 * (-1.0 / 3600
+                + z2 * (1.0 / 211680 + z2 * (-1.0 / 10886400
+                + z2 * (1.0 / 526901760 + z2 * (-4.064761645144226e-11))))))));
+            auto li2 = -series - z2 / 2;
+            auto result = ax * ax / 2 - ax * ln2 + (li2 + std::numbers::pi * std::numbers::pi / 12) / 2;
+            return std::copysign(result, x);
+        }
+    };
+
+    // Cubic, Pow5, Pow7 and Hard are odd polynomials clamped at |x| = 1, so
+    // F1 is even, F2 is odd, and beyond the knee both continue along the
+    // constant (f), linear (F1) and quadratic (F2) extensions.
+    template<typename Poly>
+    struct ClampedCurve
+    {
+        static double f(double x) noexcept
+        {
+            return Poly::f(std::clamp(x, -1.0, 1.0));
+        }
+
+        static double F1(double x) noexcept
+        {
+            auto ax = std::abs(x);
+            if (ax < 1)
+                return Poly::F1(ax);
+            return Poly::F1(1) + Poly::f(1) * (ax - 1);
+        }
+
+        static double F2(double x) noexcept
+        {
+            auto ax = std::abs(x);
+            double result;
+            if (ax < 1)
+                result = Poly::F2(ax);
+            else
+            {
+                auto d = ax - 1;
+                result = Poly::F2(1) + Poly::F1(1) * d + Poly::f(1) * d * d / 2;
+            }
+            return std::copysign(result, x);
+        }
+    };
+
+    struct CubicPoly
+    {
+        static double f(double x) noexcept { return x - x * x * x / 3; }
+        static double F1(double x) noexcept { auto x2 = x * x; return x2 * (1.0 / 2 - x2 / 12); }
+        static double F2(double x) noexcept { auto x2 = x * x; return x * x2 * (1.0 / 6 - x2 / 60); }
+    };
+
+    struct Pow5Poly
+    {
+        static double f(double x) noexcept { auto x2 = x * x; return x * (1 + x2 * (-1.0 / 6 - x2 / 10)); }
+        static double F1(double x) noexcept { auto x2 = x * x; return x2 * (1.0 / 2 + x2 * (-1.0 / 24 - x2 / 60)); }
+        static double F2(double x) noexcept { auto x2 = x * x; return x * x2 * (1.0 / 6 + x2 * (-1.0 / 120 - x2 / 420)); }
+    };
+
+    struct Pow7Poly
+    {
+        static double f(double x) noexcept { auto x2 = x * x; return x * (1 + x2 * (-1.0 / 12 + x2 * (-1.0 / 16 - x2 / 16))); }
+        static double F1(double x) noexcept { auto x2 = x * x; return x2 * (1.0 / 2 + x2 * (-1.0 / 48 + x2 * (-1.0 / 96 - x2 / 128))); }
+        static double F2(double x) noexcept { auto x2 = x * x; return x * x2 * (1.0 / 6 + x2 * (-1.0 / 240 + x2 * (-1.0 / 672 - x2 / 1152))); }
+    };
+
+    struct HardPoly
+    {
+        static double f(double x) noexcept { return x; }
+        static double F1(double x) noexcept { return x * x / 2; }
+        static double F2(double x) noexcept { return x * x * x / 6; }
+    };
+
+    //==========================================================================
+    template<typename Curve, typename SampleType>
+    void processFirstOrder(const Curve& curve, AntiderivativeShaper::ChannelState& state, const SampleType* input, SampleType* output, int numSamples) noexcept
+    {
+        auto x1 = state.x1;
+        auto F1x1 = state.antiderivative;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto x = static_cast<double>(input[i]);
+            auto F1x = curve.F1(x);
+            auto diff = x - x1;
+
+            auto y = std::abs(diff) < tolerance ? curve.f((x + x1) / 2)
+                                                : (F1x - F1x1) / diff;
+
+            output[i] = static_cast<SampleType>(y);
+            x1 = x;
+            F1x1 = F1x;
+        }
+
+        state.x1 = x1;
+        state.antiderivative = F1x1;
+    }
+
+    template<typename Curve, typename SampleType>
+    void processSecondOrder(const Curve& curve, AntiderivativeShaper::ChannelState& state, const SampleType* input, SampleType* output, int numSamples) noexcept
+    {
+        auto x1 = state.x1;
+        auto x2 = state.x2;
+        auto F2x1 = state.antiderivative;
+        auto d2 = state.d2;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto x = static_cast<double>(input[i]);
+            auto F2x = curve.F2(x);
+
+            auto diff1 = x - x1;
+            auto d1 = std::abs(diff1) < tolerance ? curve.F1((x + x1) / 2)
+                                                  : (F2x - F2x1) / diff1;
+
+            double y;
+            auto diff2 = x - x2;
+            if (std::abs(diff2) >= tolerance)
+            {
+                y = 2 * (d1 - d2) / diff2;
+            }
+            else
+            {
+                // x and x2 coincide, so the second divided difference is
+                // taken around their midpoint instead.
+                auto xBar = (x + x2) / 2;
+                auto delta = xBar - x1;
+
+                if (std::abs(delta) < tolerance)
+                    y = curve.f((xBar + x1) / 2);
+                else
+                    y = 2 / delta * (curve.F1(xBar) + (F2x1 - curve.F2(xBar)) / delta);
+            }
+
+            output[i] = static_cast<SampleType>(y);
+            x2 = x1;
+            x1 = x;
+            F2x1 = F2x;
+            d2 = d1;
+        }
+
+        state.x1 = x1;
+        state.x2 = x2;
+        state.antiderivative = F2x1;
+        state.d2 = d2;
+    }
+
+    // Recomputes the cached antiderivative terms after the curve or mode has
+    // changed, so the next block's differences use the new curve throughout.
+    template<typename Curve>
+    void refreshState(const Curve& curve, AntiderivativeShaper::ChannelState& state, AntialiasingModes mode) noexcept
+    {
+        if (mode == AntialiasingModes::FirstOrderADAA)
+        {
+            state.antiderivative = curve.F1(state.x1);
+        }
+        else
+        {
+            state.antiderivative = curve.F2(state.x1);
+            auto diff = state.x1 - state.x2;
+            state.d2 = std::abs(diff) < tolerance ? curve.F1((state.x1 + state.x2) / 2)
+                                                  : (state.antiderivative - curve.F2(state.x2)) / diff;
+        }
+    }
+
+    template<typename Curve, typename SampleType>
+    void processWithCurve(const Curve& curve, AntiderivativeShaper::ChannelState& state, AntialiasingModes mode,
+        const SampleType* input, SampleType* output, int numSamples) noexcept
+    {
+        if (state.needsRefresh)
+        {
+            refreshState(curve, state, mode);
+            state.needsRefresh = false;
+        }
+
+        if (mode == AntialiasingModes::FirstOrderADAA)
+            processFirstOrder(curve, state, input, output, numSamples);
+        else
+            processSecondOrder(curve, state, input, output, numSamples);
+    }
+}
+
+//==============================================================================
+void AntiderivativeShaper::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    states.assign(spec.numChannels, ChannelState{});
+}
+
+void AntiderivativeShaper::reset() noexcept
+{
+    std::fill(states.begin(), states.end(), ChannelState{});
+}
+
+void AntiderivativeShaper::invalidateCaches() noexcept
+{
+    for (auto& state : states)
+        state.needsRefresh = true;
+}
+
+void AntiderivativeShaper::setDistType(DistTypes newType) noexcept
+{
+    if (newType != distType)
+    {
+        distType = newType;
+        invalidateCaches();
+    }
+}
+
+void AntiderivativeShaper::setCustomCurve(const CustomCurveTable* newCurve) noexcept
+{
+    if (newCurve != customCurve)
+    {
+        customCurve = newCurve;
+        if (distType == DistTypes::Custom)
+            invalidateCaches();
+    }
+}
+
+void AntiderivativeShaper::setMode(AntialiasingModes newMode) noexcept
+{
+    if (newMode != mode)
+    {
+        mode = newMode;
+        invalidateCaches();
+    }
+}
+
+double AntiderivativeShaper::getDelayInSamples(AntialiasingModes mode) noexcept
+{
+    switch (mode)
+    {
+    case FirstOrderADAA: return 0.5;
+    case SecondOrderADAA: return 1.0;
+    case NoAntialiasing: break;
+    }
+    return 0.0;
+}
+
+void AntiderivativeShaper::processChannel(size_t channel, const float* input, float* output, int numSamples) noexcept
+{
+    processChannelSamples(channel, input, output, numSamples);
+}
+
+void AntiderivativeShaper::processChannel(size_t channel, const double* input, double* output, int numSamples) noexcept
+{
+    processChannelSamples(channel, input, output, numSamples);
+}
+
+void AntiderivativeShaper::bypassChannel(size_t channel, const float* input, float* output, int numSamples) noexcept
+{
+    bypassChannelSamples(channel, input, output, numSamples);
+}
+
+void AntiderivativeShaper::bypassChannel(size_t channel, const double* input, double* output, int numSamples) noexcept
+{
+    bypassChannelSamples(channel, input, output, numSamples);
+}
+
+template<typename SampleType>
+void AntiderivativeShaper::bypassChannelSamples(size_t channel, const SampleType* input, SampleType* output, int numSamples) noexcept
+{
+    jassert(channel < states.size());
+
+    auto& state = states[channel];
+
+    // Only second order's delay is a whole sample; first order's half is
+    // never reported, so it passes straight through.
+    auto delayed = mode == AntialiasingModes::SecondOrderADAA;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto x = static_cast<double>(input[i]);
+        output[i] = delayed ? static_cast<SampleType>(state.x1) : input[i];
+        state.x2 = state.x1;
+        state.x1 = x;
+    }
+
+    // The cached antiderivatives are for the old history.
+    state.needsRefresh = true;
+}
+
+template<typename SampleType>
+void AntiderivativeShaper::processChannelSamples(size_t channel, const SampleType* input, SampleType* output, int numSamples) noexcept
+{
+    jassert(channel < states.size());
+    jassert(mode != AntialiasingModes::NoAntialiasing);
+
+    auto& state = states[channel];
+
+    switch (distType)
+    {
+    case ArcTan: processWithCurve(ArcTanCurve{}, state, mode, input, output, numSamples); break;
+    case HypTan: processWithCurve(HypTanCurve{}, state, mode, input, output, numSamples); break;
+    case Cubic:  processWithCurve(ClampedCurve<CubicPoly>{}, state, mode, input, output, numSamples); break;
+    case Pow5:   processWithCurve(ClampedCurve<Pow5Poly>{}, state, mode, input, output, numSamples); break;
+    case Pow7:   processWithCurve(ClampedCurve<Pow7Poly>{}, state, mode, input, output, numSamples); break;
+    case Hard:   processWithCurve(ClampedCurve<HardPoly>{}, state, mode, input, output, numSamples); break;
+    case Custom: processWithCurve(*customCurve, state, mode, input, output, numSamples); break;
+    }
+}
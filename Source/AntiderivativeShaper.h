@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    AntiderivativeShaper.h
+
+    Antiderivative anti-aliasing (ADAA) versions of the transfer curves.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "WaveShapers.h"
+
+enum AntialiasingModes
+{
+    NoAntialiasing,
+    FirstOrderADAA,
+    SecondOrderADAA
+};
+
+//==============================================================================
+/**
+    Shapes each sample using the closed-form first or second antiderivative
+    of the selected curve (tabulated, for Custom), rather than the curve
+    itself, which suppresses much of the aliasing of the plain shaper.
+
+    First order outputs (F1(x[n]) - F1(x[n-1])) / (x[n] - x[n-1]) and delays
+    the signal by half a sample. Second order takes the divided difference of
+    F2 twice and delays by one sample. When the samples involved are closer
+    than a tolerance, the quotients are ill-conditioned and the curve is
+    evaluated at their midpoint instead.
+
+    Bypassed, second order still delays by its whole sample, so the latency
+    reported for it holds either way, and both orders keep their input
+    history, so switching back in starts clean.
+
+    All the arithmetic is in double precision, since the differences of
+    antiderivatives cancel heavily. State is kept per channel.
+*/
+struct AntiderivativeShaper
+{
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    void setDistType(DistTypes newType) noexcept;
+    DistTypes getDistType() const noexcept { return distType; }
+
+    void setCustomCurve(const CustomCurveTable* newCurve) noexcept;
+
+    void setMode(AntialiasingModes newMode) noexcept;
+    AntialiasingModes getMode() const noexcept { return mode; }
+
+    // The delay the current mode adds, in samples at the rate it runs at.
+    static double getDelayInSamples(AntialiasingModes mode) noexcept;
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        auto&& inBlock = context.getInputBlock();
+        auto&& outBlock = context.getOutputBlock();
+
+        jassert(inBlock.getNumChannels() == outBlock.getNumChannels());
+        jassert(inBlock.getNumChannels() <= states.size());
+
+        if (context.isBypassed)
+        {
+            for (size_t ch = 0; ch < inBlock.getNumChannels(); ++ch)
+                bypassChannel(ch, inBlock.getChannelPointer(ch),
+                    outBlock.getChannelPointer(ch),
+                    static_cast<int>(inBlock.getNumSamples()));
+            return;
+        }
+
+        for (size_t ch = 0; ch < inBlock.getNumChannels(); ++ch)
+            processChannel(ch, inBlock.getChannelPointer(ch),
+                outBlock.getChannelPointer(ch),
+                static_cast<int>(inBlock.getNumSamples()));
+    }
+
+    void processChannel(size_t channel, const float* input, float* output, int numSamples) noexcept;
+    void processChannel(size_t channel, const double* input, double* output, int numSamples) noexcept;
+
+    // The unshaped input, delayed as the current mode delays it.
+    void bypassChannel(size_t channel, const float* input, float* output, int numSamples) noexcept;
+    void bypassChannel(size_t channel, const double* input, double* output, int numSamples) noexcept;
+
+    struct ChannelState
+    {
+        double x1 = 0, x2 = 0;     // previous inputs
+        double antiderivative = 0; // F1(x1) or F2(x1), depending on the mode
+        double d2 = 0;             // previous first divided difference (second order)
+        bool needsRefresh = true;  // curve or mode changed since the cache was filled
+    };
+
+private:
+    template<typename SampleType>
+    void processChannelSamples(size_t channel, const SampleType* input, SampleType* output, int numSamples) noexcept;
+
+    template<typename SampleType>
+    void bypassChannelSamples(size_t channel, const SampleType* input, SampleType* output, int numSamples) noexcept;
+
+    std::vector<ChannelState> states;
+    DistTypes distType{ DistTypes::ArcTan };
+    const CustomCurveTable* customCurve = &CustomCurveTable::getDefault();
+    AntialiasingModes mode{ AntialiasingModes::NoAntialiasing };
+
+    void invalidateCaches() noexcept;
+};
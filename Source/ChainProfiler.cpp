@@ -0,0 +1,189 @@
+/*
+  ==============================================================================
+
+    ChainProfiler.cpp
+
+  ==============================================================================
+*/
+
+#include "ChainProfiler.h"
+
+#if TESTDISTORTION_PROFILING
+
+#include <bit>
+#include <cmath>
+
+namespace
+{
+    void storeMax(std::atomic<juce::uint64>& target, juce::uint64 value) noexcept
+    {
+        auto current = target.load(std::memory_order_relaxed);
+        while (value > current && ! target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+    void storeMax(std::atomic<float>& target, float value) noexcept
+    {
+        auto current = target.load(std::memory_order_relaxed);
+        while (value > current && ! target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+    juce::String formatNanoseconds(double nanoseconds)
+    {
+        if (nanoseconds >= 1.0e6)
+            return juce::String(nanoseconds / 1.0e6, 2) + " ms";
+        if (nanoseconds >= 1.0e3)
+            return juce::String(nanoseconds / 1.0e3, 2) + " us";
+        return juce::String(nanoseconds, 0) + " ns";
+    }
+
+    juce::String describe(const char* name, const TimingHistogram::Summary& summary)
+    {
+        return juce::String(name).paddedRight(' ', 10)
+             + " calls " + juce::String(summary.count)
+             + "  mean " + formatNanoseconds(summary.getMeanNanoseconds())
+             + "  p50 " + formatNanoseconds(summary.getPercentileNanoseconds(50))
+             + "  p99 " + formatNanoseconds(summary.getPercentileNanoseconds(99))
+             + "  max " + formatNanoseconds(static_cast<double>(summary.maxNanoseconds));
+    }
+}
+
+//==============================================================================
+void TimingHistogram::add(juce::uint64 nanoseconds) noexcept
+{
+    auto bucket = juce::jmin(numBuckets - 1, static_cast<int>(std::bit_width(nanoseconds)) - 1);
+
+    buckets[static_cast<size_t>(juce::jmax(0, bucket))].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    storeMax(maxNanoseconds, nanoseconds);
+}
+
+void TimingHistogram::clear() noexcept
+{
+    for (auto& bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+
+    count.store(0, std::memory_order_relaxed);
+    totalNanoseconds.store(0, std::memory_order_relaxed);
+    maxNanoseconds.store(0, std::memory_order_relaxed);
+}
+
+TimingHistogram::Summary TimingHistogram::getSummary() const noexcept
+{
+    Summary summary;
+    summary.count = count.load(std::memory_order_relaxed);
+    summary.totalNanoseconds = totalNanoseconds.load(std::memory_order_relaxed);
+    summary.maxNanoseconds = maxNanoseconds.load(std::memory_order_relaxed);
+
+    for (size_t b = 0; b < buckets.size(); ++b)
+        summary.buckets[b] = buckets[b].load(std::memory_order_relaxed);
+
+    return summary;
+}
+
+double TimingHistogram::Summary::getMeanNanoseconds() const noexcept
+{
+    return count > 0 ? static_cast<double>(totalNanoseconds) / static_cast<double>(count) : 0.0;
+}
+
+double TimingHistogram::Summary::getPercentileNanoseconds(double percentile) const noexcept
+{
+    // The buckets are read one by one while the audio thread adds, so
+    // their sum may not match count exactly.
+    juce::uint64 total = 0;
+    for (auto n : buckets)
+        total += n;
+
+    if (total == 0)
+        return 0.0;
+
+    auto rank = static_cast<juce::uint64>(std::ceil(percentile / 100.0 * static_cast<double>(total)));
+    juce::uint64 seen = 0;
+
+    for (int b = 0; b < numBuckets; ++b)
+    {
+        seen += buckets[static_cast<size_t>(b)];
+        if (seen >= rank)
+            return juce::jmin(std::ldexp(1.0, b + 1), static_cast<double>(maxNanoseconds));
+    }
+
+    return static_cast<double>(maxNanoseconds);
+}
+
+//==============================================================================
+double ChainProfiler::getAverageLoad() const noexcept
+{
+    auto deadline = totalDeadlineNanoseconds.load(std::memory_order_relaxed);
+    auto summary = blockTimes.getSummary();
+    return deadline > 0 ? static_cast<double>(summary.totalNanoseconds) / static_cast<double>(deadline) : 0.0;
+}
+
+double ChainProfiler::getPeakLoad() const noexcept
+{
+    return peakLoad.load(std::memory_order_relaxed);
+}
+
+void ChainProfiler::clear() noexcept
+{
+    for (auto& histogram : stageTimes)
+        histogram.clear();
+
+    blockTimes.clear();
+    deadlineMisses.store(0, std::memory_order_relaxed);
+    totalDeadlineNanoseconds.store(0, std::memory_order_relaxed);
+    peakLoad.store(0, std::memory_order_relaxed);
+}
+
+void ChainProfiler::blockProcessed(juce::uint64 nanoseconds, juce::uint64 deadlineNanoseconds) noexcept
+{
+    blockTimes.add(nanoseconds);
+
+    if (deadlineNanoseconds == 0)
+        return;
+
+    totalDeadlineNanoseconds.fetch_add(deadlineNanoseconds, std::memory_order_relaxed);
+    storeMax(peakLoad, static_cast<float>(nanoseconds) / static_cast<float>(deadlineNanoseconds));
+
+    if (nanoseconds > deadlineNanoseconds)
+        deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+}
+
+juce::String ChainProfiler::createReport() const
+{
+    juce::String report;
+
+    report << describe("Block", getBlockSummary()) << juce::newLine
+           << "Load: average " << juce::String(getAverageLoad() * 100.0, 1) << "%, peak "
+           << juce::String(getPeakLoad() * 100.0, 1) << "%, deadline misses " << juce::String(getNumDeadlineMisses())
+           << juce::newLine << juce::newLine;
+
+    for (int stage = 0; stage < maxStages; ++stage)
+        report << describe(getStageName(stage), getStageSummary(stage)) << juce::newLine;
+
+    // The raw buckets, one row per histogram, for plotting elsewhere.
+    report << juce::newLine << "Bucket counts (bucket b is 2^b to 2^(b+1) ns)" << juce::newLine;
+
+    auto addBuckets = [&report](const char* name, const TimingHistogram::Summary& summary)
+    {
+        report << name;
+        for (auto n : summary.buckets)
+            report << "," << juce::String(n);
+        report << juce::newLine;
+    };
+
+    addBuckets("Block", getBlockSummary());
+    for (int stage = 0; stage < maxStages; ++stage)
+        addBuckets(getStageName(stage), getStageSummary(stage));
+
+    return report;
+}
+
+juce::Result ChainProfiler::dumpToFile(const juce::File& file) const
+{
+    if (! file.replaceWithText(createReport()))
+        return juce::Result::fail("Could not write " + file.getFullPathName());
+
+    return juce::Result::ok();
+}
+
+#endif
@@ -0,0 +1,230 @@
+/*
+  ==============================================================================
+
+    ChainProfiler.h
+
+    Optional timing of each MonoChain stage and of processBlock as a whole,
+    kept in lock-free histograms for the editor and for dumping to a file.
+
+    Build with TESTDISTORTION_PROFILING=1 (the Profile configuration does)
+    to turn it on. With the flag off, Profiled<Stage> is Stage itself and
+    the profiler and its timers are empty, so nothing is left in the
+    processing code.
+
+    On the reference path each MonoChain stage is timed per channel. On
+    the VectorChain path each pass is timed per lane group, into the
+    histogram of the stage it stands for; when the gains and curve run as
+    one fused pass, that pass counts as WaveShape and the gains show none.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <utility>
+
+#ifndef TESTDISTORTION_PROFILING
+ #define TESTDISTORTION_PROFILING 0
+#endif
+
+#if TESTDISTORTION_PROFILING
+
+//==============================================================================
+/**
+    Durations in nanoseconds, counted into power-of-two buckets: bucket b
+    holds durations from 2^b up to 2^(b+1) ns, and the last one everything
+    longer. Any thread may add; every counter is a relaxed atomic, so the
+    worker threads of a wide bus can share one.
+*/
+struct TimingHistogram
+{
+    static constexpr int numBuckets = 32;
+
+    struct Summary
+    {
+        juce::uint64 count = 0, totalNanoseconds = 0, maxNanoseconds = 0;
+        std::array<juce::uint64, numBuckets> buckets{};
+
+        double getMeanNanoseconds() const noexcept;
+
+        // The upper edge of the bucket the percentile falls in, so an
+        // estimate on the high side.
+        double getPercentileNanoseconds(double percentile) const noexcept;
+    };
+
+    void add(juce::uint64 nanoseconds) noexcept;
+
+    // Message thread. Counts added meanwhile may be split across the clear.
+    void clear() noexcept;
+    Summary getSummary() const noexcept;
+
+private:
+    std::atomic<juce::uint64> count{ 0 }, totalNanoseconds{ 0 }, maxNanoseconds{ 0 };
+    std::array<std::atomic<juce::uint64>, numBuckets> buckets{};
+};
+
+// Times its own scope into a histogram. With no histogram it reads no clock.
+struct ScopedTiming
+{
+    using Clock = std::chrono::steady_clock;
+
+    explicit ScopedTiming(TimingHistogram* histogramToUse) noexcept :
+        histogram(histogramToUse),
+        start(histogram != nullptr ? Clock::now() : Clock::time_point())
+    {
+    }
+
+    ~ScopedTiming()
+    {
+        if (histogram != nullptr)
+            histogram->add(static_cast<juce::uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()));
+    }
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedTiming)
+
+private:
+    TimingHistogram* histogram;
+    Clock::time_point start;
+};
+
+// A chain stage that times its process() calls, bypassed ones included.
+template<typename Stage>
+struct Profiled : Stage
+{
+    void setHistogram(TimingHistogram* newHistogram) noexcept { histogram = newHistogram; }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        ScopedTiming timing(histogram);
+        Stage::process(context);
+    }
+
+private:
+    TimingHistogram* histogram = nullptr;
+};
+
+//==============================================================================
+/**
+    One processor's stage and block timings. Stage n of every attached chain
+    feeds histogram n, so the figures cover all channels.
+
+    Each processBlock is also checked against its deadline, the time its
+    samples last at the sample rate. The load is the block time as a share
+    of that.
+*/
+class ChainProfiler
+{
+public:
+    static constexpr int maxStages = 8;
+
+    explicit ChainProfiler(const std::array<const char*, maxStages>& stageNamesToUse) noexcept : stageNames(stageNamesToUse) {}
+
+    // Off the audio thread, once the chains are in place.
+    template<typename Chain>
+    void attach(Chain& chain) noexcept
+    {
+        [this, &chain]<size_t... stages>(std::index_sequence<stages...>)
+        {
+            (chain.template get<static_cast<int>(stages)>().setHistogram(&stageTimes[stages]), ...);
+        }(std::make_index_sequence<maxStages>());
+    }
+
+    // Times one processBlock.
+    struct ScopedBlock
+    {
+        ScopedBlock(ChainProfiler& profilerToUse, int numSamplesInBlock, double sampleRate) noexcept :
+            profiler(profilerToUse),
+            deadlineNanoseconds(sampleRate > 0 ? static_cast<juce::uint64>(1.0e9 * numSamplesInBlock / sampleRate) : 0),
+            start(ScopedTiming::Clock::now())
+        {
+        }
+
+        ~ScopedBlock()
+        {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(ScopedTiming::Clock::now() - start).count();
+            profiler.blockProcessed(static_cast<juce::uint64>(elapsed), deadlineNanoseconds);
+        }
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedBlock)
+
+    private:
+        ChainProfiler& profiler;
+        juce::uint64 deadlineNanoseconds;
+        ScopedTiming::Clock::time_point start;
+    };
+
+    // Times one pass of a chain that isn't built from Profiled stages into
+    // stage's histogram. With no profiler it reads no clock.
+    struct ScopedStage
+    {
+        ScopedStage(ChainProfiler* profiler, int stage) noexcept :
+            timing(profiler != nullptr ? &profiler->stageTimes[static_cast<size_t>(stage)] : nullptr)
+        {
+        }
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedStage)
+
+    private:
+        ScopedTiming timing;
+    };
+
+    const char* getStageName(int stage) const noexcept { return stageNames[static_cast<size_t>(stage)]; }
+    TimingHistogram::Summary getStageSummary(int stage) const noexcept { return stageTimes[static_cast<size_t>(stage)].getSummary(); }
+    TimingHistogram::Summary getBlockSummary() const noexcept { return blockTimes.getSummary(); }
+
+    juce::uint64 getNumDeadlineMisses() const noexcept { return deadlineMisses.load(std::memory_order_relaxed); }
+
+    // Block time over deadline, as a fraction: averaged over all blocks,
+    // and for the worst block.
+    double getAverageLoad() const noexcept;
+    double getPeakLoad() const noexcept;
+
+    void clear() noexcept;
+
+    // Every histogram as plain text, for the dump.
+    juce::String createReport() const;
+    juce::Result dumpToFile(const juce::File& file) const;
+
+private:
+    void blockProcessed(juce::uint64 nanoseconds, juce::uint64 deadlineNanoseconds) noexcept;
+
+    std::array<const char*, maxStages> stageNames;
+    std::array<TimingHistogram, maxStages> stageTimes;
+    TimingHistogram blockTimes;
+
+    std::atomic<juce::uint64> deadlineMisses{ 0 }, totalDeadlineNanoseconds{ 0 };
+    std::atomic<float> peakLoad{ 0 };
+};
+
+#else
+
+template<typename Stage>
+using Profiled = Stage;
+
+class ChainProfiler
+{
+public:
+    static constexpr int maxStages = 8;
+
+    explicit ChainProfiler(const std::array<const char*, maxStages>&) noexcept {}
+
+    template<typename Chain>
+    void attach(Chain&) noexcept {}
+
+    struct ScopedBlock
+    {
+        ScopedBlock(ChainProfiler&, int, double) noexcept {}
+    };
+
+    struct ScopedStage
+    {
+        ScopedStage(ChainProfiler*, int) noexcept {}
+    };
+};
+
+#endif
@@ -0,0 +1,320 @@
+/*
+  ==============================================================================
+
+    CustomCurve.cpp
+
+  ==============================================================================
+*/
+
+#include "CustomCurve.h"
+#include <cmath>
+
+const CustomCurveTable& CustomCurveTable::getDefault()
+{
+    static const CustomCurveTable table([](double x) { return std::clamp(x, -1.0, 1.0); }, {});
+    return table;
+}
+
+void CustomCurveTable::integrate()
+{
+    firstIntegral.assign(values.size(), 0.0);
+    secondIntegral.assign(values.size(), 0.0);
+
+    // Integrated segment by segment, outwards from x = 0 (the middle
+    // point), so both antiderivatives are zero there.
+    auto h = spacing;
+    auto f = [this](int i) { return static_cast<double>(values[static_cast<size_t>(i)]); };
+    auto& F1 = firstIntegral;
+    auto& F2 = secondIntegral;
+
+    for (int i = tableSize / 2; i < tableSize; ++i)
+    {
+        auto k = static_cast<size_t>(i);
+        F1[k + 1] = F1[k] + h * (f(i) + f(i + 1)) / 2;
+        F2[k + 1] = F2[k] + h * F1[k] + h * h * (f(i) / 3 + f(i + 1) / 6);
+    }
+
+    for (int i = tableSize / 2; i > 0; --i)
+    {
+        auto k = static_cast<size_t>(i);
+        F1[k - 1] = F1[k] - h * (f(i - 1) + f(i)) / 2;
+        F2[k - 1] = F2[k] - (h * F1[k - 1] + h * h * (f(i - 1) / 3 + f(i) / 6));
+    }
+}
+
+int CustomCurveTable::getSegment(double x, double& offset) const noexcept
+{
+    // NaN fails every comparison below; a NaN offset carries it through.
+    if (! (x == x))
+    {
+        offset = x;
+        return 0;
+    }
+
+    if (x <= -inputRange)
+    {
+        offset = x + inputRange;
+        return 0;
+    }
+
+    if (x >= inputRange)
+    {
+        offset = x - inputRange;
+        return tableSize;
+    }
+
+    auto index = std::min(static_cast<int>((x + inputRange) / spacing), tableSize - 1);
+    offset = x - getInput(index);
+    return index;
+}
+
+double CustomCurveTable::f(double x) const noexcept
+{
+    return processSample(x);
+}
+
+// Within a segment the curve is f0 + slope s, s being the offset into it;
+// F1 and F2 are its integrals from the segment start. Outside the table
+// the slope is zero.
+double CustomCurveTable::F1(double x) const noexcept
+{
+    double s;
+    auto i = getSegment(x, s);
+    auto k = static_cast<size_t>(i);
+
+    auto f0 = static_cast<double>(values[k]);
+    auto slope = (s < 0 || i == tableSize) ? 0.0 : (values[k + 1] - f0) / spacing;
+    return firstIntegral[k] + s * (f0 + s * slope / 2);
+}
+
+double CustomCurveTable::F2(double x) const noexcept
+{
+    double s;
+    auto i = getSegment(x, s);
+    auto k = static_cast<size_t>(i);
+
+    auto f0 = static_cast<double>(values[k]);
+    auto slope = (s < 0 || i == tableSize) ? 0.0 : (values[k + 1] - f0) / spacing;
+    return secondIntegral[k] + s * (firstIntegral[k] + s * (f0 / 2 + s * slope / 6));
+}
+
+//==============================================================================
+namespace
+{
+    enum InterpolationModes
+    {
+        LinearInterpolation,
+        SplineInterpolation
+    };
+
+    // Fritsch-Carlson tangents: a cubic Hermite spline through monotonic
+    // points that stays monotonic between them, so it can't overshoot.
+    std::vector<double> getMonotoneTangents(const std::vector<double>& x, const std::vector<double>& y)
+    {
+        auto n = x.size();
+        std::vector<double> secants(n - 1), tangents(n);
+
+        for (size_t i = 0; i + 1 < n; ++i)
+            secants[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]);
+
+        tangents[0] = secants[0];
+        tangents[n - 1] = secants[n - 2];
+
+        for (size_t i = 1; i + 1 < n; ++i)
+            tangents[i] = secants[i - 1] * secants[i] <= 0 ? 0.0 : (secants[i - 1] + secants[i]) / 2;
+
+        for (size_t i = 0; i + 1 < n; ++i)
+        {
+            if (secants[i] == 0)
+            {
+                tangents[i] = tangents[i + 1] = 0;
+                continue;
+            }
+
+            auto a = tangents[i] / secants[i];
+            auto b = tangents[i + 1] / secants[i];
+            auto r = a * a + b * b;
+
+            if (r > 9)
+            {
+                auto t = 3 / std::sqrt(r);
+                tangents[i] = t * a * secants[i];
+                tangents[i + 1] = t * b * secants[i];
+            }
+        }
+
+        return tangents;
+    }
+}
+
+juce::Result CustomCurveLoader::parse(const juce::String& text, std::unique_ptr<CustomCurveTable>& result)
+{
+    auto mode = -1;
+    auto numColumns = 0;
+    std::vector<double> xs, ys;
+
+    juce::StringArray lines;
+    lines.addLines(text);
+
+    for (int lineIndex = 0; lineIndex < lines.size(); ++lineIndex)
+    {
+        auto line = lines[lineIndex].upToFirstOccurrenceOf("#", false, false).trim();
+        if (line.isEmpty())
+            continue;
+
+        auto where = "line " + juce::String(lineIndex + 1) + ": ";
+
+        if (line.startsWithIgnoreCase("interpolation"))
+        {
+            auto name = line.fromFirstOccurrenceOf(" ", false, false).trim();
+            if (name.equalsIgnoreCase("linear"))
+                mode = InterpolationModes::LinearInterpolation;
+            else if (name.equalsIgnoreCase("spline"))
+                mode = InterpolationModes::SplineInterpolation;
+            else
+                return juce::Result::fail(where + "unknown interpolation \"" + name + "\"");
+            continue;
+        }
+
+        auto tokens = juce::StringArray::fromTokens(line, " \t,;", {});
+        tokens.removeEmptyStrings();
+
+        if (tokens.size() < 1 || tokens.size() > 2 || (numColumns != 0 && tokens.size() != numColumns))
+            return juce::Result::fail(where + "expected " + (numColumns == 1 ? "one number" : "two numbers"));
+
+        numColumns = tokens.size();
+
+        std::vector<double> numbers;
+        for (const auto& token : tokens)
+        {
+            if (! token.containsOnly("0123456789+-.eE"))
+                return juce::Result::fail(where + "\"" + token + "\" is not a number");
+
+            auto value = token.getDoubleValue();
+            if (! std::isfinite(value))
+                return juce::Result::fail(where + "\"" + token + "\" is not finite");
+
+            numbers.push_back(value);
+        }
+
+        if (numColumns == 2)
+            xs.push_back(numbers[0]);
+        ys.push_back(numbers.back());
+
+        auto y = ys.back();
+        if (std::abs(y) > maxOutput)
+            return juce::Result::fail(where + "output " + juce::String(y) + " is beyond +-" + juce::String(maxOutput));
+
+        if (ys.size() > 1 && y < ys[ys.size() - 2])
+            return juce::Result::fail(where + "the curve must not go down");
+
+        if (numColumns == 2)
+        {
+            auto x = xs.back();
+            if (std::abs(x) > CustomCurveTable::inputRange)
+                return juce::Result::fail(where + "input " + juce::String(x) + " is beyond +-" + juce::String(CustomCurveTable::inputRange));
+
+            if (xs.size() > 1 && x <= xs[xs.size() - 2])
+                return juce::Result::fail(where + "inputs must increase");
+        }
+    }
+
+    if (ys.size() < 2)
+        return juce::Result::fail("a curve needs at least two points");
+
+    // A sampled table spans [-1, 1].
+    if (numColumns == 1)
+        for (size_t i = 0; i < ys.size(); ++i)
+            xs.push_back(-1.0 + 2.0 * static_cast<double>(i) / static_cast<double>(ys.size() - 1));
+
+    if (mode < 0)
+        mode = numColumns == 2 ? InterpolationModes::SplineInterpolation : InterpolationModes::LinearInterpolation;
+
+    auto tangents = mode == InterpolationModes::SplineInterpolation ? getMonotoneTangents(xs, ys) : std::vector<double>();
+
+    auto curve = [&xs, &ys, &tangents](double x)
+    {
+        if (x <= xs.front())
+            return ys.front();
+        if (x >= xs.back())
+            return ys.back();
+
+        auto i = static_cast<size_t>(std::upper_bound(xs.begin(), xs.end(), x) - xs.begin()) - 1;
+        auto h = xs[i + 1] - xs[i];
+        auto t = (x - xs[i]) / h;
+
+        if (tangents.empty())
+            return ys[i] + t * (ys[i + 1] - ys[i]);
+
+        auto t2 = t * t;
+        auto t3 = t2 * t;
+        return (2 * t3 - 3 * t2 + 1) * ys[i] + (t3 - 2 * t2 + t) * h * tangents[i]
+             + (-2 * t3 + 3 * t2) * ys[i + 1] + (t3 - t2) * h * tangents[i + 1];
+    };
+
+    result = std::make_unique<CustomCurveTable>(curve, text);
+    return juce::Result::ok();
+}
+
+juce::Result CustomCurveLoader::load(const juce::File& file, std::unique_ptr<CustomCurveTable>& result)
+{
+    if (! file.existsAsFile())
+        return juce::Result::fail(file.getFullPathName() + " does not exist");
+
+    auto parsed = parse(file.loadFileAsString(), result);
+    if (parsed.failed())
+        return juce::Result::fail(file.getFileName() + ", " + parsed.getErrorMessage());
+
+    return parsed;
+}
+
+//==============================================================================
+void CustomCurveSlot::publish(std::unique_ptr<CustomCurveTable> table)
+{
+    jassert(table != nullptr);
+
+    if (owned != nullptr)
+        retired.push_back(std::move(owned));
+
+    owned = std::move(table);
+    current.store(owned.get());
+    version.fetch_add(1, std::memory_order_relaxed);
+
+    reclaim();
+
+    if (! retired.empty())
+        startTimer(reclaimIntervalMs);
+}
+
+const CustomCurveTable* CustomCurveSlot::acquire() noexcept
+{
+    // Advertise the table before using it, then check it is still current.
+    // If publish() swapped it out in between, it may not have seen the
+    // hazard, so go again with the new one.
+    auto* table = current.load();
+
+    for (;;)
+    {
+        inUse.store(table);
+
+        auto* latest = current.load();
+        if (latest == table)
+            return table;
+
+        table = latest;
+    }
+}
+
+void CustomCurveSlot::timerCallback()
+{
+    reclaim();
+
+    if (retired.empty())
+        stopTimer();
+}
+
+void CustomCurveSlot::reclaim() const noexcept
+{
+    auto* hazard = inUse.load();
+    std::erase_if(retired, [hazard](const auto& table) { return table.get() != hazard; });
+}
@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    CustomCurve.h
+
+    User-defined transfer curves, loaded from text on the message thread
+    and handed to the audio thread as ready-made lookup tables.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/**
+    A custom curve sampled at tableSize + 1 evenly spaced inputs over
+    [-inputRange, inputRange], and read back with linear interpolation.
+    Beyond the range the curve holds its end values.
+
+    The first and second antiderivatives of that piecewise-linear curve are
+    stored at the same points, so F1 and F2 are exact for what the plain
+    shaper plays, and the ADAA shaper can use a custom curve like any other.
+    Both are zero at x = 0.
+
+    Immutable once built, so any number of threads can read one.
+*/
+class CustomCurveTable
+{
+public:
+    static constexpr int tableSize = 4096;
+    static constexpr float inputRange = 8.f;
+
+    // Samples curve(x), which must be monotonic and bounded.
+    template<typename Curve>
+    CustomCurveTable(Curve&& curve, const juce::String& sourceText) :
+        source(sourceText)
+    {
+        values.resize(tableSize + 1);
+        for (int i = 0; i <= tableSize; ++i)
+            values[static_cast<size_t>(i)] = static_cast<float>(curve(getInput(i)));
+
+        integrate();
+    }
+
+    // y = x, clipped at +-1; what Custom plays before a curve is loaded.
+    static const CustomCurveTable& getDefault();
+
+    template<typename SampleType>
+    SampleType processSample(SampleType x) const noexcept
+    {
+        // std::clamp lets NaN through, and NaN as an index is undefined, so
+        // it goes straight out again, as it does through the other curves.
+        if (! (x == x))
+            return x;
+
+        auto pos = (std::clamp(x, static_cast<SampleType>(-inputRange), static_cast<SampleType>(inputRange)) + inputRange) * scale;
+        auto index = std::min(static_cast<int>(pos), tableSize - 1);
+        auto frac = pos - static_cast<SampleType>(index);
+        const auto* v = values.data() + index;
+        return v[0] + frac * (v[1] - v[0]);
+    }
+
+    // The curve and its antiderivatives, in double for the ADAA shaper.
+    double f(double x) const noexcept;
+    double F1(double x) const noexcept;
+    double F2(double x) const noexcept;
+
+    // The text the curve was loaded from, for saving with the plugin state.
+    const juce::String& getSource() const noexcept { return source; }
+
+    static double getInput(int index) noexcept { return -inputRange + index * spacing; }
+
+private:
+    static constexpr double spacing = 2.0 * inputRange / tableSize;
+    static constexpr float scale = static_cast<float>(tableSize / (2.0 * inputRange));
+
+    void integrate();
+
+    // Which segment x falls in, and how far into it (negative or beyond
+    // the spacing outside the table).
+    int getSegment(double x, double& offset) const noexcept;
+
+    std::vector<float> values;
+    std::vector<double> firstIntegral, secondIntegral;
+    juce::String source;
+};
+
+//==============================================================================
+/**
+    Turns curve files into tables. A file is plain text, one point per
+    line, with '#' starting a comment:
+
+        interpolation spline      (or linear)
+        -1.0  -0.8
+         0.0   0.0
+         1.0   0.8
+
+    Two numbers per line are x and y breakpoints, with x increasing and
+    within +-CustomCurveTable::inputRange. One number per line is a sampled
+    table whose points are spread evenly over [-1, 1]. Breakpoints default
+    to a monotone cubic spline, sampled tables to linear interpolation.
+
+    The curve must not decrease, and its outputs must lie within
+    +-maxOutput, so a bad file can't make the shaper blow up.
+*/
+struct CustomCurveLoader
+{
+    static constexpr double maxOutput = 2.0;
+
+    // Off the audio thread only: parses, validates and builds the table.
+    static juce::Result parse(const juce::String& text, std::unique_ptr<CustomCurveTable>& result);
+    static juce::Result load(const juce::File& file, std::unique_ptr<CustomCurveTable>& result);
+};
+
+//==============================================================================
+/**
+    Hands the current custom curve to the audio thread.
+
+    publish() swaps the new table in with one atomic store. The audio
+    thread calls acquire() once per block and can use what it gets until
+    its next call. It advertises that table in a hazard pointer. Replaced
+    tables are kept until the hazard no longer points at them. publish()
+    and getCurrent() free any that are done with, and a timer checks every
+    so often while any are left, so the audio thread never frees anything
+    and a table replaced during playback doesn't wait for the next publish().
+    The timer needs a running message loop; without one (the command-line
+    tools) the leftovers go on the next publish(), getCurrent() or when the
+    slot is destroyed.
+
+    Publishing and freeing both happen on the message thread, so a table
+    the editor gets from getCurrent() can't go away while it draws.
+*/
+class CustomCurveSlot : private juce::Timer
+{
+public:
+    CustomCurveSlot() = default;
+    ~CustomCurveSlot() override { stopTimer(); }
+
+    // Message thread only.
+    void publish(std::unique_ptr<CustomCurveTable> table);
+
+    // Message thread. Valid until the end of the caller's callback.
+    const CustomCurveTable& getCurrent() const noexcept { reclaim(); return *current.load(); }
+
+    // Goes up by one with every publish, for readers that cache a drawing.
+    juce::uint32 getVersion() const noexcept { return version.load(std::memory_order_relaxed); }
+
+    // Audio thread only.
+    const CustomCurveTable* acquire() noexcept;
+
+private:
+    static constexpr int reclaimIntervalMs = 100;
+
+    void timerCallback() override;
+    void reclaim() const noexcept;
+
+    std::atomic<const CustomCurveTable*> current{ &CustomCurveTable::getDefault() };
+    std::atomic<const CustomCurveTable*> inUse{ nullptr };
+    std::atomic<juce::uint32> version{ 0 };
+
+    // Message thread only.
+    std::unique_ptr<CustomCurveTable> owned;
+    mutable std::vector<std::unique_ptr<CustomCurveTable>> retired;
+};
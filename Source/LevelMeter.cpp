@@ -0,0 +1,35 @@
+/*
+  ==============================================================================
+
+    LevelMeter.cpp
+
+  ==============================================================================
+*/
+
+#include "LevelMeter.h"
+
+const std::array<float, TruePeakInterpolator::oversampling * TruePeakInterpolator::tapsPerPhase>& TruePeakInterpolator::getCoefficients()
+{
+    static const auto coefficients = []
+    {
+        std::array<float, oversampling * tapsPerPhase> h{};
+
+        // Centred on a multiple of the oversampling factor, so phase 0 is
+        // exactly the input and the other phases fall between samples.
+        constexpr auto length = static_cast<double>(h.size());
+        constexpr auto centre = length / 2;
+        constexpr auto pi = juce::MathConstants<double>::pi;
+
+        for (size_t j = 0; j < h.size(); ++j)
+        {
+            auto t = (static_cast<double>(j) - centre) / oversampling;
+            auto sinc = t == 0.0 ? 1.0 : std::sin(pi * t) / (pi * t);
+            auto window = 0.42 - 0.5 * std::cos(2 * pi * j / length) + 0.08 * std::cos(4 * pi * j / length);
+            h[j] = static_cast<float>(sinc * window);
+        }
+
+        return h;
+    }();
+
+    return coefficients;
+}
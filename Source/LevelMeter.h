@@ -0,0 +1,213 @@
+/*
+  ==============================================================================
+
+    LevelMeter.h
+
+    Peak, RMS and true-peak metering done on the audio thread, and published
+    as a handful of atomics for the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <type_traits>
+
+enum MeterPoints
+{
+    PreShaperPoint,
+    PostShaperPoint
+};
+
+enum VisualisationModes
+{
+    NoVisualisation,
+    MetersOnly,
+    MetersAndSamples
+};
+
+// Linear levels; the editor converts to decibels.
+struct MeterLevels
+{
+    float peak{ 0 }, rms{ 0 }, truePeak{ 0 };
+
+    void combine(const MeterLevels& other) noexcept
+    {
+        peak = juce::jmax(peak, other.peak);
+        rms = juce::jmax(rms, other.rms);
+        truePeak = juce::jmax(truePeak, other.truePeak);
+    }
+
+    bool operator==(const MeterLevels&) const = default;
+};
+
+// Written by processBlock, read by the editor whenever it likes.
+struct PublishedMeter
+{
+    // Returns false if the levels are the ones already there.
+    bool store(const MeterLevels& levels) noexcept
+    {
+        auto changed = peak.exchange(levels.peak, std::memory_order_relaxed) != levels.peak;
+        changed |= rms.exchange(levels.rms, std::memory_order_relaxed) != levels.rms;
+        changed |= truePeak.exchange(levels.truePeak, std::memory_order_relaxed) != levels.truePeak;
+        return changed;
+    }
+
+    MeterLevels load() const noexcept
+    {
+        MeterLevels levels;
+        levels.peak = peak.load(std::memory_order_relaxed);
+        levels.rms = rms.load(std::memory_order_relaxed);
+        levels.truePeak = truePeak.load(std::memory_order_relaxed);
+        return levels;
+    }
+
+private:
+    std::atomic<float> peak{ 0 }, rms{ 0 }, truePeak{ 0 };
+};
+
+// The 4x interpolator the true-peak meter uses: a windowed sinc split into
+// four phases. Phase 0 is the samples themselves, so only 1 to 3 are run.
+struct TruePeakInterpolator
+{
+    static constexpr int oversampling = 4;
+    static constexpr int tapsPerPhase = 12;
+
+    static const std::array<float, oversampling * tapsPerPhase>& getCoefficients();
+};
+
+//==============================================================================
+/**
+    Meters one stream of SampleType, which is float, double, or
+    SIMDRegister<float> with one channel per lane.
+
+    Peaks fall back with a 50 ms release and RMS is averaged over 300 ms,
+    so a reader polling at frame rate sees every peak without having to
+    collect them itself. Everything is reduced a block at a time with
+    vector operations, and the square root for RMS is left to the reader.
+*/
+template<typename SampleType>
+struct LevelMeter
+{
+    static constexpr double peakReleaseSeconds = 0.05;
+    static constexpr double rmsWindowSeconds = 0.3;
+
+    void prepare(double sampleRate, int maximumBlockSize)
+    {
+        peakRelease = static_cast<float>(std::exp(-1.0 / (peakReleaseSeconds * sampleRate)));
+        rmsDecay = static_cast<float>(std::exp(-1.0 / (rmsWindowSeconds * sampleRate)));
+
+        history.allocate(static_cast<size_t>(maximumBlockSize + historySize), true);
+        capacity = static_cast<size_t>(maximumBlockSize);
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        peak = rms = truePeak = SampleType();
+
+        if (history.get() != nullptr)
+            std::fill(history.get(), history.get() + historySize, SampleType());
+    }
+
+    void process(const SampleType* data, size_t numSamples) noexcept
+    {
+        jassert(numSamples <= capacity);
+        numSamples = juce::jmin(numSamples, capacity);
+        if (numSamples == 0)
+            return;
+
+        const auto& h = TruePeakInterpolator::getCoefficients();
+        constexpr auto taps = static_cast<size_t>(TruePeakInterpolator::tapsPerPhase);
+        constexpr auto phases = static_cast<size_t>(TruePeakInterpolator::oversampling);
+
+        // The previous block's last samples come first, so the interpolator
+        // can look back across the block boundary.
+        auto* work = history.get();
+        std::copy(data, data + numSamples, work + historySize);
+
+        SampleType blockPeak{}, blockTruePeak{}, sumOfSquares{};
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto* newest = work + historySize + i;
+            auto x = *newest;
+
+            blockPeak = maximum(blockPeak, absolute(x));
+            sumOfSquares = sumOfSquares + x * x;
+
+            for (size_t phase = 1; phase < phases; ++phase)
+            {
+                SampleType interpolated{};
+                for (size_t k = 0; k < taps; ++k)
+                    interpolated = interpolated + *(newest - k) * h[k * phases + phase];
+
+                blockTruePeak = maximum(blockTruePeak, absolute(interpolated));
+            }
+        }
+
+        std::copy(work + numSamples, work + numSamples + historySize, work);
+
+        auto n = static_cast<float>(numSamples);
+        auto release = std::pow(peakRelease, n);
+        auto decay = std::pow(rmsDecay, n);
+
+        peak = maximum(blockPeak, peak * release);
+        truePeak = maximum(maximum(blockTruePeak, blockPeak), truePeak * release);
+        rms = rms * decay + sumOfSquares * ((1.f - decay) / n);
+    }
+
+    // The levels of one lane (always 0 for float and double).
+    MeterLevels getLevels(size_t lane) const noexcept
+    {
+        MeterLevels levels;
+        levels.peak = laneOf(peak, lane);
+        levels.rms = std::sqrt(laneOf(rms, lane));
+        levels.truePeak = laneOf(truePeak, lane);
+        return levels;
+    }
+
+private:
+    static constexpr int historySize = TruePeakInterpolator::tapsPerPhase - 1;
+
+    static SampleType absolute(SampleType x) noexcept
+    {
+        if constexpr (std::is_floating_point_v<SampleType>)
+            return std::abs(x);
+        else
+            return SampleType::abs(x);
+    }
+
+    static SampleType maximum(SampleType a, SampleType b) noexcept
+    {
+        if constexpr (std::is_floating_point_v<SampleType>)
+            return juce::jmax(a, b);
+        else
+            return SampleType::max(a, b);
+    }
+
+    static float laneOf(SampleType x, size_t lane) noexcept
+    {
+        if constexpr (std::is_floating_point_v<SampleType>)
+        {
+            juce::ignoreUnused(lane);
+            return static_cast<float>(x);
+        }
+        else
+        {
+            return x.get(lane);
+        }
+    }
+
+    juce::HeapBlock<SampleType> history;
+    size_t capacity = 0;
+
+    // rms holds the mean square.
+    SampleType peak{}, rms{}, truePeak{};
+    float peakRelease = 0.f, rmsDecay = 0.f;
+};
@@ -0,0 +1,218 @@
+/*
+  ==============================================================================
+
+    MultibandShaper.cpp
+
+  ==============================================================================
+*/
+
+#include "MultibandShaper.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Each half of a Linkwitz-Riley crossover is a Butterworth pair.
+    constexpr float crossoverDamping = juce::MathConstants<float>::sqrt2;
+
+    // The crossovers in rising order, whatever order they were set in.
+    std::array<float, MultibandSettings::maxCrossovers> getSortedCrossovers(const MultibandSettings& settings) noexcept
+    {
+        auto freqs = settings.crossoverFreqs;
+        auto numCrossovers = juce::jlimit(0, MultibandSettings::maxCrossovers, settings.numBands - 1);
+        std::sort(freqs.begin(), freqs.begin() + numCrossovers);
+        return freqs;
+    }
+}
+
+void MultibandShaper::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    hostSampleRate = spec.sampleRate;
+    sampleRate = hostSampleRate * rateMultiplier;
+    channels.assign(spec.numChannels, ChannelState());
+
+    for (auto& gain : crossoverGains)
+        gain.reset(sampleRate, CutoffSmoother<float>::defaultRampSeconds);
+    for (auto& gain : bandGains)
+        gain.reset(sampleRate, CutoffSmoother<float>::defaultRampSeconds);
+
+    updateCrossoverTargets();
+    updateOutputMixes();
+    reset();
+}
+
+void MultibandShaper::reset() noexcept
+{
+    for (auto& gain : crossoverGains)
+        gain.setCurrentAndTargetValue(gain.getTargetValue());
+    for (auto& gain : bandGains)
+        gain.setCurrentAndTargetValue(gain.getTargetValue());
+
+    advanceSmoothing();
+
+    std::fill(channels.begin(), channels.end(), ChannelState());
+}
+
+void MultibandShaper::setRateMultiplier(int multiplier) noexcept
+{
+    if (multiplier == rateMultiplier)
+        return;
+
+    rateMultiplier = multiplier;
+    sampleRate = hostSampleRate * rateMultiplier;
+
+    // The glides are counted in samples at the new rate, and the crossover
+    // gains depend on it. The oversampler restarts from clean on a change,
+    // so the crossovers do too.
+    for (auto& gain : crossoverGains)
+        gain.reset(sampleRate, CutoffSmoother<float>::defaultRampSeconds);
+    for (auto& gain : bandGains)
+        gain.reset(sampleRate, CutoffSmoother<float>::defaultRampSeconds);
+
+    updateCrossoverTargets();
+    reset();
+}
+
+void MultibandShaper::setSettings(const MultibandSettings& newSettings) noexcept
+{
+    auto bandsChanged = newSettings.numBands != settings.numBands;
+    settings = newSettings;
+    settings.numBands = juce::jlimit(1, MultibandSettings::maxBands, settings.numBands);
+
+    for (size_t k = 0; k < bandGains.size(); ++k)
+        bandGains[k].setTargetValue(juce::Decibels::decibelsToGain(settings.bandGains[k]));
+
+    alignas(Vec::SIMDRegisterSize) float types[Vec::size()];
+    for (size_t k = 0; k < Vec::size(); ++k)
+        types[k] = static_cast<int>(k) < settings.numBands ? static_cast<float>(settings.bandTypes[k]) : -1.f;
+
+    bandTypeLanes = Vec::fromRawArray(types);
+
+    updateCrossoverTargets();
+
+    // Crossovers that were idle hold stale state, and the ones that move
+    // up or down the order now split different signals.
+    if (bandsChanged)
+        std::fill(channels.begin(), channels.end(), ChannelState());
+}
+
+double MultibandShaper::getDecaySeconds(const MultibandSettings& settings, double attenuationDecibels) noexcept
+{
+    CutSlopeLayout layout;
+    layout.numSections = 2;
+    layout.damping[0] = layout.damping[1] = crossoverDamping;
+
+    auto freqs = getSortedCrossovers(settings);
+    auto seconds = 0.0;
+
+    for (int j = 0; j < settings.numBands - 1; ++j)
+        seconds += layout.getDecaySeconds(freqs[static_cast<size_t>(j)], attenuationDecibels);
+
+    return seconds;
+}
+
+MultibandShaper::BandCurves MultibandShaper::selectCurves(const CurveShaper& shaper) const noexcept
+{
+    static constexpr auto kernels = makeKernels(std::make_index_sequence<numKernels>());
+
+    BandCurves curves;
+    auto tier = static_cast<int>(shaper.getAccuracyTier());
+
+    for (size_t k = 0; k < static_cast<size_t>(settings.numBands); ++k)
+    {
+        auto type = settings.bandTypes[k];
+        auto isNewType = true;
+        for (size_t j = 0; j < k; ++j)
+            isNewType = isNewType && settings.bandTypes[j] != type;
+
+        if (! isNewType)
+            continue;
+
+        curves.kernels[curves.numCurves] = kernels[static_cast<size_t>(static_cast<int>(type) * numTiers + tier)];
+        curves.lanes[curves.numCurves] = Vec::equal(bandTypeLanes, Vec(static_cast<float>(type)));
+        ++curves.numCurves;
+    }
+
+    return curves;
+}
+
+void MultibandShaper::shapeBands(const BandCurves& curves, const CurveShaper& shaper, const Vec* bands, size_t numSamples) noexcept
+{
+    std::fill_n(shaped.begin(), numSamples, Vec(0.f));
+
+    // Every curve runs on all the lanes; the mask zeroes the bands that
+    // use another curve, and the lanes past the last band, before the sum.
+    for (size_t c = 0; c < curves.numCurves; ++c)
+        curves.kernels[c](shaper, bands, shaped.data(), numSamples, curves.lanes[c]);
+}
+
+bool MultibandShaper::isSmoothing() const noexcept
+{
+    for (const auto& gain : crossoverGains)
+        if (gain.isSmoothing())
+            return true;
+
+    for (const auto& gain : bandGains)
+        if (gain.isSmoothing())
+            return true;
+
+    return false;
+}
+
+void MultibandShaper::advanceSmoothing() noexcept
+{
+    for (size_t j = 0; j < crossoverGains.size(); ++j)
+        coefficients[j] = SvfCoefficients<float>::make(crossoverGains[j].getNextValue(), crossoverDamping);
+
+    alignas(Vec::SIMDRegisterSize) float values[Vec::size()]{};
+    for (size_t k = 0; k < bandGains.size(); ++k)
+        values[k] = bandGains[k].getNextValue();
+
+    gains = Vec::fromRawArray(values);
+}
+
+void MultibandShaper::updateCrossoverTargets() noexcept
+{
+    auto freqs = getSortedCrossovers(settings);
+
+    for (size_t j = 0; j < crossoverGains.size(); ++j)
+    {
+        // Keep clear of Nyquist, where tan blows up.
+        auto fc = juce::jlimit(1.0, 0.49 * sampleRate, static_cast<double>(freqs[j]));
+        crossoverGains[j].setTargetValue(static_cast<float>(std::tan(juce::MathConstants<double>::pi * fc / sampleRate)));
+    }
+}
+
+void MultibandShaper::updateOutputMixes() noexcept
+{
+    // A section's input is lowPass + damping * bandPass + highPass, so
+    // those weights pass it straight through, and flipping the band-pass
+    // sign makes the all-pass that the low and high halves add up to.
+    alignas(Vec::SIMDRegisterSize) float first[3][Vec::size()];
+    alignas(Vec::SIMDRegisterSize) float second[3][Vec::size()];
+
+    for (size_t j = 0; j < static_cast<size_t>(maxCrossovers); ++j)
+    {
+        for (size_t k = 0; k < Vec::size(); ++k)
+        {
+            if (k > j)
+            {
+                first[0][k] = 0.f;  first[1][k] = 0.f;               first[2][k] = 1.f;
+                second[0][k] = 0.f; second[1][k] = 0.f;              second[2][k] = 1.f;
+            }
+            else if (k == j)
+            {
+                first[0][k] = 1.f;  first[1][k] = 0.f;               first[2][k] = 0.f;
+                second[0][k] = 1.f; second[1][k] = 0.f;              second[2][k] = 0.f;
+            }
+            else
+            {
+                first[0][k] = 1.f;  first[1][k] = -crossoverDamping; first[2][k] = 1.f;
+                second[0][k] = 1.f; second[1][k] = crossoverDamping; second[2][k] = 1.f;
+            }
+        }
+
+        firstMixes[j] = { Vec::fromRawArray(first[0]), Vec::fromRawArray(first[1]), Vec::fromRawArray(first[2]) };
+        secondMixes[j] = { Vec::fromRawArray(second[0]), Vec::fromRawArray(second[1]), Vec::fromRawArray(second[2]) };
+    }
+}
@@ -0,0 +1,247 @@
+/*
+  ==============================================================================
+
+    MultibandShaper.h
+
+    The multiband form of the WaveShape stage: Linkwitz-Riley crossovers
+    split the signal into up to four bands, each with its own gain and
+    curve, with the bands carried side by side in SIMDRegister lanes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <utility>
+#include <vector>
+#include "WaveShapers.h"
+#include "TptFilter.h"
+
+struct MultibandSettings
+{
+    static constexpr int maxBands = 4;
+    static constexpr int maxCrossovers = maxBands - 1;
+
+    // 1 is the plain full-band shaper.
+    int numBands{ 1 };
+    std::array<float, maxCrossovers> crossoverFreqs{};
+    std::array<float, maxBands> bandGains{};
+    std::array<DistTypes, maxBands> bandTypes{};
+};
+
+//==============================================================================
+/**
+    Splits each channel with 24 dB/oct Linkwitz-Riley crossovers, shapes
+    every band with its own gain and curve, and sums the bands back up.
+
+    Band k lives in lane k. Every crossover runs as the same pair of TPT
+    state-variable sections across all lanes. Each lane picks the low-pass,
+    high-pass or all-pass output, so a lane comes out as its band:
+        lane k, crossover j:  high-pass if j < k, low-pass if j == k,
+                              all-pass if j > k.
+    Each band is then phase-matched to the others, and with flat gains and
+    no curve the sum is an all-pass. A 4-band split costs six vector
+    sections per sample, where a tree of scalar crossovers with all-pass
+    compensation would run nine scalar ones.
+
+    The curves differ per band. Each curve in use is picked once per block
+    from a table of register kernels, and runs over a chunk of samples on
+    every lane; each band then keeps the lanes of its own curve. With one
+    curve for all bands that is a single register pass per sample.
+
+    The lanes are float, and there are too few double lanes for four
+    bands, so double samples are narrowed to float at the stage's input
+    and widened again at its output.
+    Crossover frequencies and band gains glide like the chain's cutoffs and
+    gains. Changing the number of bands clears the crossover state.
+*/
+struct MultibandShaper
+{
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static_assert(Vec::size() >= MultibandSettings::maxBands, "one band per lane");
+
+    // The spec's rate is the host rate; see setRateMultiplier().
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    // How many times the host rate process() is called at, which is the
+    // oversampling factor when the stage is oversampled.
+    void setRateMultiplier(int multiplier) noexcept;
+
+    void setSettings(const MultibandSettings& newSettings) noexcept;
+    bool isActive() const noexcept { return settings.numBands > 1; }
+
+    // How long the crossovers ring before falling by attenuationDecibels.
+    static double getDecaySeconds(const MultibandSettings& settings, double attenuationDecibels) noexcept;
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context, const CurveShaper& shaper) noexcept
+    {
+        using SampleType = typename ProcessContext::SampleType;
+
+        auto&& inBlock = context.getInputBlock();
+        auto&& outBlock = context.getOutputBlock();
+
+        jassert(inBlock.getNumChannels() == outBlock.getNumChannels());
+        jassert(inBlock.getNumChannels() <= channels.size());
+
+        if (context.isBypassed)
+        {
+            if (context.usesSeparateInputAndOutputBlocks())
+                outBlock.copyFrom(inBlock);
+            return;
+        }
+
+        auto numChannels = juce::jmin(inBlock.getNumChannels(), channels.size());
+        auto numSamples = inBlock.getNumSamples();
+        auto curves = selectCurves(shaper);
+
+        for (size_t start = 0; start < numSamples; start += chunkSize)
+        {
+            auto length = juce::jmin(chunkSize, numSamples - start);
+
+            // Sample by sample across the channels, so the glides are worked
+            // out once for all of them.
+            for (size_t i = 0; i < length; ++i)
+            {
+                if (isSmoothing())
+                    advanceSmoothing();
+
+                for (size_t ch = 0; ch < numChannels; ++ch)
+                {
+                    auto x = static_cast<float>(inBlock.getChannelPointer(ch)[start + i]);
+                    channels[ch].bands[i] = splitSample(channels[ch], x);
+                }
+            }
+
+            for (size_t ch = 0; ch < numChannels; ++ch)
+            {
+                shapeBands(curves, shaper, channels[ch].bands.data(), length);
+
+                auto* output = outBlock.getChannelPointer(ch) + start;
+                for (size_t i = 0; i < length; ++i)
+                    output[i] = static_cast<SampleType>(shaped[i].sum());
+            }
+        }
+    }
+
+private:
+    static constexpr int maxCrossovers = MultibandSettings::maxCrossovers;
+
+    // Samples split and shaped at a time, so the bands stay in L1.
+    static constexpr size_t chunkSize = 64;
+
+    // Low-pass, band-pass and high-pass weights for a section's outputs.
+    struct OutputMix
+    {
+        Vec lowPass, bandPass, highPass;
+    };
+
+    struct Section
+    {
+        Vec ic1{}, ic2{};
+    };
+
+    struct ChannelState
+    {
+        std::array<Section, maxCrossovers> first, second;
+
+        // The current chunk, split and scaled by the band gains.
+        std::array<Vec, chunkSize> bands;
+    };
+
+    using LaneKernel = void (*)(const CurveShaper&, const Vec*, Vec*, size_t, Vec::vMaskType) noexcept;
+    static constexpr int numTiers = AccuracyTiers::ExactTier + 1;
+    static constexpr int numKernels = (DistTypes::Custom + 1) * numTiers;
+
+    // Adds the curve of every sample to shaped, on the given lanes only.
+    template<DistTypes type, AccuracyTiers tier>
+    static void shapeLanesAs(const CurveShaper& shaper, const Vec* bands, Vec* shaped, size_t numSamples, Vec::vMaskType lanes) noexcept
+    {
+        for (size_t i = 0; i < numSamples; ++i)
+            shaped[i] += shaper.processSampleAs<type, tier>(bands[i]) & lanes;
+    }
+
+    // Kernel index = curve * numTiers + tier. Curves without tiers share
+    // their Standard kernel across all three.
+    static constexpr DistTypes getKernelType(size_t index) noexcept
+    {
+        return static_cast<DistTypes>(index / numTiers);
+    }
+
+    static constexpr AccuracyTiers getKernelTier(size_t index) noexcept
+    {
+        return CurveShaper::hasAccuracyTiers(getKernelType(index)) ? static_cast<AccuracyTiers>(index % numTiers)
+                                                                       : AccuracyTiers::StandardTier;
+    }
+
+    template<size_t... indices>
+    static constexpr std::array<LaneKernel, numKernels> makeKernels(std::index_sequence<indices...>) noexcept
+    {
+        return { &MultibandShaper::shapeLanesAs<getKernelType(indices), getKernelTier(indices)>... };
+    }
+
+    // One kernel per distinct curve among the bands, with the lanes of the
+    // bands that use it.
+    struct BandCurves
+    {
+        std::array<LaneKernel, MultibandSettings::maxBands> kernels{};
+        std::array<Vec::vMaskType, MultibandSettings::maxBands> lanes{};
+        size_t numCurves = 0;
+    };
+
+    BandCurves selectCurves(const CurveShaper& shaper) const noexcept;
+    void shapeBands(const BandCurves& curves, const CurveShaper& shaper, const Vec* bands, size_t numSamples) noexcept;
+
+    bool isSmoothing() const noexcept;
+    void advanceSmoothing() noexcept;
+    void updateCrossoverTargets() noexcept;
+    void updateOutputMixes() noexcept;
+
+    static Vec tickSection(Vec x, Section& section, const SvfCoefficients<float>& c, const OutputMix& mix) noexcept
+    {
+        auto v3 = x - section.ic2;
+        auto v1 = section.ic1 * c.a1 + v3 * c.a2;
+        auto v2 = section.ic2 + section.ic1 * c.a2 + v3 * c.a3;
+        section.ic1 = v1 * 2.f - section.ic1;
+        section.ic2 = v2 * 2.f - section.ic2;
+
+        auto highPass = x - v1 * c.damping - v2;
+        return v2 * mix.lowPass + v1 * mix.bandPass + highPass * mix.highPass;
+    }
+
+    Vec splitSample(ChannelState& state, float input) noexcept
+    {
+        auto x = Vec(input);
+
+        for (size_t j = 0; j < static_cast<size_t>(settings.numBands - 1); ++j)
+        {
+            x = tickSection(x, state.first[j], coefficients[j], firstMixes[j]);
+            x = tickSection(x, state.second[j], coefficients[j], secondMixes[j]);
+        }
+
+        return x * gains;
+    }
+
+    MultibandSettings settings;
+
+    std::vector<ChannelState> channels;
+
+    double hostSampleRate = 44100.0;
+    double sampleRate = 44100.0;
+    int rateMultiplier = 1;
+
+    std::array<juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>, maxCrossovers> crossoverGains;
+    std::array<juce::SmoothedValue<float>, MultibandSettings::maxBands> bandGains;
+
+    // Both sections of crossover j share coefficients[j].
+    std::array<SvfCoefficients<float>, maxCrossovers> coefficients;
+    std::array<OutputMix, maxCrossovers> firstMixes, secondMixes;
+    Vec gains{ 1.f };
+
+    // Each band's curve in its lane, and -1 in the lanes no band uses.
+    Vec bandTypeLanes{ -1.f };
+    std::array<Vec, chunkSize> shaped;
+};
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    OversampledWaveShaper.cpp
+
+  ==============================================================================
+*/
+
+#include "OversampledWaveShaper.h"
+
+template<typename SampleType>
+void OversampledWaveShaper<SampleType>::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    shaper.prepare(spec);
+    adaa.prepare(spec);
+    multiband.prepare(spec);
+
+    for (int order = 1; order <= maxOversamplingOrder; ++order)
+    {
+        for (int type = 0; type < numFilterTypes; ++type)
+        {
+            auto linearPhase = type == 1;
+            auto filterType = linearPhase ? Oversampler::filterHalfBandFIREquiripple
+                                          : Oversampler::filterHalfBandPolyphaseIIR;
+
+            auto& os = oversamplers[getIndex(order, linearPhase)];
+            os = std::make_unique<Oversampler>(spec.numChannels, static_cast<size_t>(order), filterType, true, true);
+            os->initProcessing(spec.maximumBlockSize);
+        }
+    }
+
+    oversampler = nullptr;
+    setOversampling(currentOrder, currentLinearPhase);
+}
+
+template<typename SampleType>
+void OversampledWaveShaper<SampleType>::reset()
+{
+    shaper.reset();
+    adaa.reset();
+    multiband.reset();
+
+    if (oversampler != nullptr)
+        oversampler->reset();
+}
+
+template<typename SampleType>
+void OversampledWaveShaper<SampleType>::setOversampling(int order, bool linearPhase) noexcept
+{
+    order = juce::jlimit(0, maxOversamplingOrder, order);
+
+    auto* next = order > 0 ? oversamplers[getIndex(order, linearPhase)].get() : nullptr;
+
+    currentOrder = order;
+    currentLinearPhase = linearPhase;
+    multiband.setRateMultiplier(1 << order);
+
+    if (next == oversampler)
+        return;
+
+    // A newly selected oversampler may hold state from when it was last used.
+    if (next != nullptr)
+        next->reset();
+
+    oversampler = next;
+}
+
+template<typename SampleType>
+void OversampledWaveShaper<SampleType>::setAntialiasing(AntialiasingModes newMode) noexcept
+{
+    if (newMode == adaa.getMode())
+        return;
+
+    // History left over from the last time ADAA was on would be stale.
+    if (adaa.getMode() == AntialiasingModes::NoAntialiasing)
+        adaa.reset();
+
+    adaa.setMode(newMode);
+}
+
+template<typename SampleType>
+int OversampledWaveShaper<SampleType>::getLatencyInSamples(int order, bool linearPhase, AntialiasingModes antialiasing) const noexcept
+{
+    order = juce::jlimit(0, maxOversamplingOrder, order);
+
+    // ADAA's delay is in samples at the oversampled rate. Only whole host
+    // samples can be reported, so the half sample of first order (or any
+    // fraction once oversampled) is left uncompensated.
+    auto latency = static_cast<int>(AntiderivativeShaper::getDelayInSamples(antialiasing) / (1 << order));
+
+    if (order > 0)
+        if (auto& os = oversamplers[getIndex(order, linearPhase)])
+            latency += juce::roundToInt(os->getLatencyInSamples());
+
+    return latency;
+}
+
+template struct OversampledWaveShaper<float>;
+template struct OversampledWaveShaper<double>;
@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    OversampledWaveShaper.h
+
+    The WaveShape stage of the chain: the curve shaper or its antiderivative
+    anti-aliased form, optionally run at a multiple of the host rate.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <memory>
+#include "WaveShapers.h"
+#include "AntiderivativeShaper.h"
+#include "MultibandShaper.h"
+
+//==============================================================================
+/**
+    Wraps CurveShaper, or AntiderivativeShaper when an ADAA mode is
+    selected, in juce::dsp::Oversampling.
+
+    Every factor (2x to 16x) and filter type is allocated in prepare(), so
+    setOversampling() only switches between prepared oversamplers and is safe
+    to call on the audio thread.
+
+    The oversamplers use integer latency so the stage's delay can be reported
+    to the host exactly. When the stage is bypassed, the signal still goes
+    through the up/down filters and the ADAA delay, so the latency does not
+    jump when distortion is toggled.
+
+    With more than one band set, the crossovers and per-band curves of a
+    MultibandShaper take the place of the single curve, at the same rate.
+    The bands use the plain curve shaper, so ADAA is off while they are.
+
+    SampleType is float or double; both are instantiated in the .cpp.
+*/
+template<typename SampleType>
+struct OversampledWaveShaper
+{
+    static constexpr int maxOversamplingOrder = 4;
+    static constexpr int numFilterTypes = 2;
+
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
+
+    void setDistType(DistTypes newType) noexcept
+    {
+        shaper.setDistType(newType);
+        adaa.setDistType(newType);
+    }
+    DistTypes getDistType() const noexcept { return shaper.getDistType(); }
+
+    // ADAA works from the closed-form antiderivatives, so it is exact
+    // whatever the tier.
+    void setAccuracyTier(AccuracyTiers newTier) noexcept { shaper.setAccuracyTier(newTier); }
+    AccuracyTiers getAccuracyTier() const noexcept { return shaper.getAccuracyTier(); }
+
+    void setCustomCurve(const CustomCurveTable* newCurve) noexcept
+    {
+        shaper.setCustomCurve(newCurve);
+        adaa.setCustomCurve(newCurve);
+    }
+
+    void setAntialiasing(AntialiasingModes newMode) noexcept;
+    AntialiasingModes getAntialiasing() const noexcept { return adaa.getMode(); }
+
+    void setMultiband(const MultibandSettings& newSettings) noexcept
+    {
+        // ADAA sat out the multiband stretch, so its history is stale.
+        if (isMultiband() && newSettings.numBands <= 1)
+            adaa.reset();
+
+        multiband.setSettings(newSettings);
+    }
+    bool isMultiband() const noexcept { return multiband.isActive(); }
+
+    // Order 0 runs the shaper at the host rate; order n runs it at 2^n times
+    // the host rate. linearPhase picks FIR rather than polyphase IIR filters.
+    void setOversampling(int order, bool linearPhase) noexcept;
+    int getOversamplingOrder() const noexcept { return currentOrder; }
+    bool isOversampling() const noexcept { return oversampler != nullptr; }
+
+    // True when the shaper keeps per-channel state or resamples, so it has to
+    // run on separate channels rather than on interleaved samples.
+    bool needsSeparateChannels() const noexcept
+    {
+        return isOversampling() || isMultiband() || adaa.getMode() != AntialiasingModes::NoAntialiasing;
+    }
+
+    int getLatencyInSamples() const noexcept { return getLatencyInSamples(currentOrder, currentLinearPhase, getEffectiveAntialiasing()); }
+    int getLatencyInSamples(int order, bool linearPhase, AntialiasingModes antialiasing) const noexcept;
+
+    // The ADAA mode that actually runs, which is none in multiband mode.
+    static AntialiasingModes getEffectiveAntialiasing(AntialiasingModes antialiasing, int numBands) noexcept
+    {
+        return numBands > 1 ? AntialiasingModes::NoAntialiasing : antialiasing;
+    }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        if (oversampler == nullptr)
+        {
+            shape(context);
+            return;
+        }
+
+        auto&& inBlock = context.getInputBlock();
+        auto&& outBlock = context.getOutputBlock();
+
+        auto upBlock = oversampler->processSamplesUp(inBlock);
+        juce::dsp::ProcessContextReplacing<SampleType> upContext(upBlock);
+        upContext.isBypassed = context.isBypassed;
+        shape(upContext);
+        oversampler->processSamplesDown(outBlock);
+    }
+
+    // Host-rate shaping of raw samples; only valid while
+    // needsSeparateChannels() is false.
+    void processSamples(const float* input, float* output, int numSamples) const noexcept
+    {
+        jassert(! needsSeparateChannels());
+        shaper.processSamples(input, output, numSamples);
+    }
+
+    // One host-rate sample, or register of samples, through a curve and
+    // tier fixed at compile time; only valid while needsSeparateChannels()
+    // is false.
+    template<DistTypes type, AccuracyTiers tier, typename ValueType>
+    ValueType processSampleAs(ValueType x) const noexcept
+    {
+        return shaper.processSampleAs<type, tier>(x);
+    }
+
+private:
+    using Oversampler = juce::dsp::Oversampling<SampleType>;
+
+    AntialiasingModes getEffectiveAntialiasing() const noexcept
+    {
+        return isMultiband() ? AntialiasingModes::NoAntialiasing : adaa.getMode();
+    }
+
+    template<typename ProcessContext>
+    void shape(const ProcessContext& context) noexcept
+    {
+        if (isMultiband())
+            multiband.process(context, shaper);
+        else if (adaa.getMode() != AntialiasingModes::NoAntialiasing)
+            adaa.process(context);
+        else
+            shaper.process(context);
+    }
+
+    static size_t getIndex(int order, bool linearPhase) noexcept
+    {
+        return static_cast<size_t>((order - 1) * numFilterTypes + (linearPhase ? 1 : 0));
+    }
+
+    CurveShaper shaper;
+    AntiderivativeShaper adaa;
+    MultibandShaper multiband;
+    std::array<std::unique_ptr<Oversampler>, maxOversamplingOrder * numFilterTypes> oversamplers;
+    Oversampler* oversampler = nullptr;
+    int currentOrder = 0;
+    bool currentLinearPhase = false;
+};
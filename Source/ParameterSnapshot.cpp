@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+    ParameterSnapshot.cpp
+
+  ==============================================================================
+*/
+
+#include "ParameterSnapshot.h"
+#include <cstring>
+#include <thread>
+
+ChainParameters::ChainParameters(juce::AudioProcessorValueTreeState& apvts) :
+    lowFreq(apvts.getRawParameterValue("LowCut Freq")),
+    highFreq(apvts.getRawParameterValue("HighCut Freq")),
+    lowCutSlope(apvts.getRawParameterValue("LowCut Slope")),
+    highCutSlope(apvts.getRawParameterValue("HighCut Slope")),
+    inGain(apvts.getRawParameterValue("Input Gain")),
+    outGain(apvts.getRawParameterValue("Output Gain")),
+    distType(apvts.getRawParameterValue("Distortion Type")),
+    accuracyTier(apvts.getRawParameterValue("Curve Accuracy")),
+    lowCutBypassed(apvts.getRawParameterValue("LowCut Bypassed")),
+    highCutBypassed(apvts.getRawParameterValue("HighCut Bypassed")),
+    distortionBypassed(apvts.getRawParameterValue("Distortion Bypassed")),
+    oversampling(apvts.getRawParameterValue("Oversampling")),
+    oversamplingFilter(apvts.getRawParameterValue("Oversampling Filter")),
+    antialiasing(apvts.getRawParameterValue("Antialiasing")),
+    numBands(apvts.getRawParameterValue(MultibandParameterIDs::numBands))
+{
+    for (size_t j = 0; j < crossoverFreqs.size(); ++j)
+        crossoverFreqs[j] = apvts.getRawParameterValue(MultibandParameterIDs::crossoverFreqs[j]);
+
+    for (size_t k = 0; k < bandGains.size(); ++k)
+    {
+        bandGains[k] = apvts.getRawParameterValue(MultibandParameterIDs::bandGains[k]);
+        bandTypes[k] = apvts.getRawParameterValue(MultibandParameterIDs::bandTypes[k]);
+    }
+}
+
+ChainSettings ChainParameters::load() const noexcept
+{
+    return makeSettings([](const char*, const std::atomic<float>* value) { return value->load(); });
+}
+
+ChainSettings ChainParameters::loadFromState(const juce::ValueTree& state) const
+{
+    return makeSettings([&state](const char* parameterID, const std::atomic<float>* value)
+    {
+        auto parameter = state.getChildWithProperty("id", parameterID);
+        return parameter.hasProperty("value") ? static_cast<float>(parameter.getProperty("value")) : value->load();
+    });
+}
+
+template<typename GetValue>
+ChainSettings ChainParameters::makeSettings(GetValue&& getValue) const
+{
+    ChainSettings settings;
+
+    settings.lowFreq = getValue("LowCut Freq", lowFreq);
+    settings.highFreq = getValue("HighCut Freq", highFreq);
+    settings.lowCutSlope = static_cast<FilterSlopes>(getValue("LowCut Slope", lowCutSlope));
+    settings.highCutSlope = static_cast<FilterSlopes>(getValue("HighCut Slope", highCutSlope));
+    settings.inGain = getValue("Input Gain", inGain);
+    settings.outGain = getValue("Output Gain", outGain);
+    settings.distType = static_cast<DistTypes>(getValue("Distortion Type", distType));
+    settings.accuracyTier = static_cast<AccuracyTiers>(getValue("Curve Accuracy", accuracyTier));
+
+    settings.lowCutBypassed = getValue("LowCut Bypassed", lowCutBypassed) > 0.5f;
+    settings.highCutBypassed = getValue("HighCut Bypassed", highCutBypassed) > 0.5f;
+    settings.distortionBypassed = getValue("Distortion Bypassed", distortionBypassed) > 0.5f;
+
+    settings.oversamplingOrder = static_cast<int>(getValue("Oversampling", oversampling));
+    settings.linearPhaseOversampling = getValue("Oversampling Filter", oversamplingFilter) > 0.5f;
+    settings.antialiasing = static_cast<AntialiasingModes>(getValue("Antialiasing", antialiasing));
+
+    // The Bands choice starts at one band.
+    settings.multiband.numBands = static_cast<int>(getValue(MultibandParameterIDs::numBands, numBands)) + 1;
+
+    for (size_t j = 0; j < crossoverFreqs.size(); ++j)
+        settings.multiband.crossoverFreqs[j] = getValue(MultibandParameterIDs::crossoverFreqs[j], crossoverFreqs[j]);
+
+    for (size_t k = 0; k < bandGains.size(); ++k)
+    {
+        settings.multiband.bandGains[k] = getValue(MultibandParameterIDs::bandGains[k], bandGains[k]);
+        settings.multiband.bandTypes[k] = static_cast<DistTypes>(getValue(MultibandParameterIDs::bandTypes[k], bandTypes[k]));
+    }
+
+    return settings;
+}
+
+//==============================================================================
+ParameterSnapshot::ParameterSnapshot(juce::AudioProcessorValueTreeState& apvts) :
+    parameters(apvts)
+{
+    // Nothing else can see this object yet, so the first publish needs no
+    // sequence dance.
+    writeWords(parameters.load());
+    sequence.store(2, std::memory_order_release);
+}
+
+void ParameterSnapshot::markChanged(int stages) noexcept
+{
+    pendingStages.fetch_or(stages, std::memory_order_acq_rel);
+
+    while (pendingStages.load(std::memory_order_acquire) != 0)
+    {
+        auto seq = sequence.load(std::memory_order_relaxed);
+        if ((seq & 1) != 0)
+            return; // the publisher will see our stages once it's done
+
+        if (! sequence.compare_exchange_weak(seq, seq + 1, std::memory_order_relaxed))
+            continue;
+
+        std::atomic_thread_fence(std::memory_order_release);
+
+        // Taking the stages before loading the values means the values are
+        // at least as new as every change being flagged.
+        auto published = pendingStages.exchange(0, std::memory_order_acq_rel);
+        writeWords(parameters.load());
+
+        sequence.store(seq + 2, std::memory_order_release);
+        changedStages.fetch_or(published, std::memory_order_release);
+    }
+}
+
+void ParameterSnapshot::writeWords(const ChainSettings& settings) noexcept
+{
+    std::array<std::uint32_t, numWords> data{};
+    std::memcpy(data.data(), &settings, sizeof(settings));
+
+    for (size_t i = 0; i < numWords; ++i)
+        words[i].store(data[i], std::memory_order_relaxed);
+}
+
+bool ParameterSnapshot::tryRead(ChainSettings& settings) const noexcept
+{
+    auto before = sequence.load(std::memory_order_acquire);
+    if ((before & 1) != 0)
+        return false;
+
+    std::array<std::uint32_t, numWords> data;
+    for (size_t i = 0; i < numWords; ++i)
+        data[i] = words[i].load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) != before)
+        return false;
+
+    std::memcpy(&settings, data.data(), sizeof(settings));
+    return true;
+}
+
+ChainSettings ParameterSnapshot::read() const noexcept
+{
+    ChainSettings settings;
+    while (! tryRead(settings))
+        std::this_thread::yield();
+    return settings;
+}
@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    ParameterSnapshot.h
+
+    The plugin's parameter values as one ChainSettings, published lock-free
+    so the audio thread and the editor never look parameters up by name.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include "WaveShapers.h"
+#include "AntiderivativeShaper.h"
+#include "TptFilter.h"
+#include "MultibandShaper.h"
+
+// IDs of the multiband parameters, by crossover or band.
+namespace MultibandParameterIDs
+{
+    inline constexpr const char* numBands = "Bands";
+    inline constexpr std::array<const char*, MultibandSettings::maxCrossovers> crossoverFreqs{ "Crossover 1 Freq", "Crossover 2 Freq", "Crossover 3 Freq" };
+    inline constexpr std::array<const char*, MultibandSettings::maxBands> bandGains{ "Band 1 Gain", "Band 2 Gain", "Band 3 Gain", "Band 4 Gain" };
+    inline constexpr std::array<const char*, MultibandSettings::maxBands> bandTypes{ "Band 1 Type", "Band 2 Type", "Band 3 Type", "Band 4 Type" };
+}
+
+struct ChainSettings
+{
+    float lowFreq{ 0 };
+    float highFreq{ 0 };
+    FilterSlopes lowCutSlope{ FilterSlopes::Slope6 }, highCutSlope{ FilterSlopes::Slope6 };
+    float inGain{ 0 };
+    float outGain{ 0 };
+    DistTypes distType { DistTypes::ArcTan };
+    AccuracyTiers accuracyTier{ AccuracyTiers::StandardTier };
+
+    bool lowCutBypassed{ false }, highCutBypassed{ false }, distortionBypassed{ false };
+
+    int oversamplingOrder{ 0 };
+    bool linearPhaseOversampling{ false };
+    AntialiasingModes antialiasing{ AntialiasingModes::NoAntialiasing };
+
+    MultibandSettings multiband;
+};
+
+// The raw parameter values behind ChainSettings, looked up once.
+struct ChainParameters
+{
+    explicit ChainParameters(juce::AudioProcessorValueTreeState& apvts);
+    ChainSettings load() const noexcept;
+
+    // The settings a state saved by getStateInformation holds. Parameters
+    // the state doesn't mention keep their current values.
+    ChainSettings loadFromState(const juce::ValueTree& state) const;
+private:
+    template<typename GetValue>
+    ChainSettings makeSettings(GetValue&& getValue) const;
+
+    std::atomic<float>* lowFreq;
+    std::atomic<float>* highFreq;
+    std::atomic<float>* lowCutSlope;
+    std::atomic<float>* highCutSlope;
+    std::atomic<float>* inGain;
+    std::atomic<float>* outGain;
+    std::atomic<float>* distType;
+    std::atomic<float>* accuracyTier;
+    std::atomic<float>* lowCutBypassed;
+    std::atomic<float>* highCutBypassed;
+    std::atomic<float>* distortionBypassed;
+    std::atomic<float>* oversampling;
+    std::atomic<float>* oversamplingFilter;
+    std::atomic<float>* antialiasing;
+    std::atomic<float>* numBands;
+    std::array<std::atomic<float>*, MultibandSettings::maxCrossovers> crossoverFreqs{};
+    std::array<std::atomic<float>*, MultibandSettings::maxBands> bandGains{};
+    std::array<std::atomic<float>*, MultibandSettings::maxBands> bandTypes{};
+};
+
+//==============================================================================
+/**
+    A versioned ChainSettings behind a seqlock.
+
+    Parameter listeners call markChanged() with the stages their parameter
+    affects. The first thread in becomes the publisher. It reloads every
+    parameter, writes the snapshot, and then flags the stages as changed. A
+    thread that arrives while another is publishing leaves its stages
+    pending for that publisher to pick up, so no caller ever waits on
+    another.
+
+    Readers copy the snapshot and check the sequence number didn't move.
+    tryRead() makes a single attempt, which is what the audio thread uses.
+    read() retries, and is for the message thread.
+*/
+struct ParameterSnapshot
+{
+    explicit ParameterSnapshot(juce::AudioProcessorValueTreeState& apvts);
+
+    // Safe on any thread, including the audio thread during automation.
+    void markChanged(int stages) noexcept;
+
+    // The stages whose settings changed since the last call. A reader that
+    // then fails tryRead() should hand them back with restoreChangedStages().
+    int takeChangedStages() noexcept { return changedStages.exchange(0, std::memory_order_acquire); }
+    void restoreChangedStages(int stages) noexcept { changedStages.fetch_or(stages, std::memory_order_relaxed); }
+
+    bool tryRead(ChainSettings& settings) const noexcept;
+    ChainSettings read() const noexcept;
+
+    // Goes up by one with every publish.
+    juce::uint32 getVersion() const noexcept { return sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    static_assert(std::is_trivially_copyable_v<ChainSettings>);
+    static constexpr size_t numWords = (sizeof(ChainSettings) + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t);
+
+    void writeWords(const ChainSettings& settings) noexcept;
+
+    ChainParameters parameters;
+
+    // Odd while a publish is in progress.
+    std::atomic<juce::uint32> sequence{ 0 };
+    std::array<std::atomic<std::uint32_t>, numWords> words{};
+
+    std::atomic<int> pendingStages{ 0 };
+    std::atomic<int> changedStages{ 0 };
+};
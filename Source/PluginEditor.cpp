@@ -192,190 +192,268 @@ juce::Rectangle<int> RotarySliderWithLabels::getSliderBounds() const
     return r;
 }
 
-TransferGraphComponent::TransferGraphComponent(TestDistortionAudioProcessor& p) :
-    audioProcessor(p),
-    leftChannelFifo(&audioProcessor.leftChannelFifo),
-    rightChannelFifo(&audioProcessor.rightChannelFifo)
+namespace
 {
-    const auto& params = audioProcessor.getParameters();
-    for (auto param : params)
+    using TransferFunction = float (*)(float);
+
+    TransferFunction getTransferFunction(DistTypes distType)
     {
-        param->addListener(this);
+        switch (distType)
+        {
+        case ArcTan:
+            return arcTanFunc;
+        case HypTan:
+            return hypTanFunc;
+        case Cubic:
+            return cubicFunc;
+        case Pow5:
+            return pow5Func;
+        case Pow7:
+            return pow7Func;
+        // Custom has no closed form; see TransferGraphComponent::shape().
+        default:
+            return hardFunc;
+        }
     }
 
-    startTimerHz(60);
+    juce::String levelText(const juce::String& name, const MeterLevels& levels)
+    {
+        using namespace juce;
+        auto dB = [](float gain) { return Decibels::toString(Decibels::gainToDecibels(gain), 1); };
+        return name + "  peak " + dB(levels.peak) + "  RMS " + dB(levels.rms) + "  true peak " + dB(levels.truePeak);
+    }
 }
 
-TransferGraphComponent::~TransferGraphComponent()
+TransferGraphComponent::TransferGraphComponent(TestDistortionAudioProcessor& p) :
+    audioProcessor(p)
 {
-    const auto& params = audioProcessor.getParameters();
-    for (auto param : params)
-    {
-        param->removeListener(this);
-    }
+    updateSettings();
+    inputText = levelText("In ", inputLevels);
+    outputText = levelText("Out", outputLevels);
+    audioProcessor.getActivityBroadcaster().addChangeListener(this);
+    startTimerHz(activeHz);
 }
 
-void TransferGraphComponent::parameterValueChanged(int parameterIndex, float newValue)
+TransferGraphComponent::~TransferGraphComponent()
 {
-    parametersChanged.set(true);
+    audioProcessor.getActivityBroadcaster().removeChangeListener(this);
 }
 
 void TransferGraphComponent::timerCallback()
 {
-    juce::AudioBuffer<float> tempIncomingBuffer;
+    inputLevels = audioProcessor.getMeterLevels(MeterPoints::PreShaperPoint);
+    outputLevels = audioProcessor.getMeterLevels(MeterPoints::PostShaperPoint);
+
     float prevMagnitude = maxMagnitude;
-    maxMagnitude = 0.0;
+    maxMagnitude = inputLevels.peak;
+    dampedMagnitude = (maxMagnitude * 3 + prevMagnitude) / 4;
+
+    bool changed = false;
 
-    while (leftChannelFifo->getNumCompleteBuffersAvailable() > 0)
+    if (updateSettings())
     {
-        if (leftChannelFifo->getAudioBuffer(tempIncomingBuffer))
-        {
-            auto size = tempIncomingBuffer.getNumSamples();
-            float incomingMagnitude = tempIncomingBuffer.getMagnitude(0, size);
-            if (incomingMagnitude > maxMagnitude)
-            {
-                maxMagnitude = incomingMagnitude;
-            }
-        }
+        // The curve gets re-rendered in paint if the key no longer matches.
+        repaint();
+        changed = true;
     }
 
-    while (rightChannelFifo->getNumCompleteBuffersAvailable() > 0)
+    auto newCrosshair = getCrosshair();
+    if (newCrosshair != crosshair)
     {
-        if (rightChannelFifo->getAudioBuffer(tempIncomingBuffer))
-        {
-            auto size = tempIncomingBuffer.getNumSamples();
-            float incomingMagnitude = tempIncomingBuffer.getMagnitude(0, size);
-            if (incomingMagnitude > maxMagnitude)
-            {
-                maxMagnitude = incomingMagnitude;
-            }
-        }
+        repaintCrosshair(crosshair);
+        repaintCrosshair(newCrosshair);
+        crosshair = newCrosshair;
+        changed = true;
     }
-    dampedMagnitude = (maxMagnitude * 3 + prevMagnitude) / 4;
 
-    if (parametersChanged.compareAndSetBool(false, true))
+    auto newInputText = levelText("In ", inputLevels);
+    auto newOutputText = levelText("Out", outputLevels);
+    if (newInputText != inputText || newOutputText != outputText)
     {
-        updateChain();
+        inputText = newInputText;
+        outputText = newOutputText;
+        repaint(getTextArea());
+        changed = true;
     }
 
-    repaint();
+    if (changed)
+        quietTicks = 0;
+    else if (++quietTicks == ticksBeforeIdle)
+        stopUntilActivity();
 }
 
-void TransferGraphComponent::updateChain()
+void TransferGraphComponent::changeListenerCallback(juce::ChangeBroadcaster* source)
 {
-    auto chainSettings = getChainSettings(audioProcessor.apvts);
+    juce::ignoreUnused(source);
 
-    monoChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    monoChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
-    monoChain.setBypassed<ChainPositions::WaveShape>(chainSettings.distortionBypassed);
+    quietTicks = 0;
+    if (! isTimerRunning())
+        startTimerHz(activeHz);
 }
 
-void TransferGraphComponent::paint(juce::Graphics& g)
+void TransferGraphComponent::stopUntilActivity()
+{
+    stopTimer();
+    audioProcessor.sleepUntilActivity();
+
+    // Anything that changed after this callback read it, but before the
+    // processor knew to send a wake-up, would otherwise be missed.
+    if (audioProcessor.getParameterSnapshot().getVersion() != settingsVersion
+        || audioProcessor.getCustomCurves().getVersion() != customCurveVersion
+        || audioProcessor.getMeterLevels(MeterPoints::PreShaperPoint) != inputLevels
+        || audioProcessor.getMeterLevels(MeterPoints::PostShaperPoint) != outputLevels)
+    {
+        quietTicks = 0;
+        startTimerHz(activeHz);
+    }
+}
+
+bool TransferGraphComponent::updateSettings()
+{
+    auto curveVersion = audioProcessor.getCustomCurves().getVersion();
+    auto curveChanged = curveVersion != customCurveVersion && chainSettings.distType == DistTypes::Custom;
+    customCurveVersion = curveVersion;
+
+    const auto& snapshot = audioProcessor.getParameterSnapshot();
+    auto version = snapshot.getVersion();
+    if (version == settingsVersion)
+        return curveChanged;
+
+    auto previous = chainSettings;
+    chainSettings = snapshot.read();
+    settingsVersion = version;
+
+    return curveChanged
+        || chainSettings.distType != previous.distType
+        || chainSettings.distortionBypassed != previous.distortionBypassed;
+}
+
+bool TransferGraphComponent::isInterestedInFileDrag(const juce::StringArray& files)
+{
+    return files.size() == 1;
+}
+
+void TransferGraphComponent::filesDropped(const juce::StringArray& files, int x, int y)
+{
+    juce::ignoreUnused(x, y);
+
+    auto result = audioProcessor.loadCustomCurve(juce::File(files[0]));
+    if (result.failed())
+    {
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Custom curve", result.getErrorMessage());
+        return;
+    }
+
+    if (auto* parameter = audioProcessor.apvts.getParameter("Distortion Type"))
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(DistTypes::Custom)));
+}
+
+float TransferGraphComponent::shape(DistTypes distType, float x) const
+{
+    if (distType == DistTypes::Custom)
+        return audioProcessor.getCustomCurves().getCurrent().processSample(x);
+
+    return getTransferFunction(distType)(x);
+}
+
+TransferGraphComponent::Crosshair TransferGraphComponent::getCrosshair() const
 {
     using namespace juce;
-    g.fillAll(Colours::black);
 
     auto graphArea = getLocalBounds();
+    if (graphArea.isEmpty())
+        return {};
 
     double aspectRatio = static_cast<double>(getWidth()) / getHeight();
 
-    g.drawImage(background, getLocalBounds().toFloat());
-
-    auto w = graphArea.getWidth();
-
-    auto& waveShape = monoChain.get<ChainPositions::WaveShape>();
-    DistTypes distType = static_cast<DistTypes>(audioProcessor.apvts.getRawParameterValue("Distortion Type")->load());
+    Crosshair c;
+    c.bypassed = chainSettings.distortionBypassed;
+    c.x = jmap(static_cast<double>(dampedMagnitude), 0.0, aspectRatio, 0.0, static_cast<double>(graphArea.getRight()));
+    c.y = jmap(static_cast<double>(shape(chainSettings.distType, dampedMagnitude)), 0.0, 1.0,
+        static_cast<double>(graphArea.getBottom()), static_cast<double>(graphArea.getY()));
+    return c;
+}
 
-    float (*wsFunc)(float);
-    wsFunc = arcTanFunc;
-    switch (distType)
-    {
-    case ArcTan:
-    {
-        wsFunc = arcTanFunc;
-        break;
-    }
-    case HypTan:
-    {
-        wsFunc = hypTanFunc;
-        break;
-    }
-    case Cubic:
-    {
-        wsFunc = cubicFunc;
-        break;
-    }
-    case Pow5:
-    {
-        wsFunc = pow5Func;
-        break;
-    }
-    case Pow7:
-    {
-        wsFunc = pow7Func;
-        break;
-    }
-    default:
-    {
-        wsFunc = hardFunc;
-        break;
-    }
-    }
+void TransferGraphComponent::repaintCrosshair(const Crosshair& c)
+{
+    // A pixel either side covers the antialiasing at fractional scales.
+    auto bottom = getHeight();
+    auto top = c.bypassed ? 0 : c.y;
 
-    auto sampleRate = audioProcessor.getSampleRate();
+    repaint(c.x - 1, top - 1, 3, bottom - top + 2);
 
-    std::vector<double> mags;
-    mags.resize(w);
+    if (! c.bypassed)
+        repaint(0, c.y - 1, c.x + 2, 3);
+}
 
-    for (int i = 0; i < w; ++i) {
-        float input = aspectRatio * static_cast<float>(i) / w;
-        mags[i] = wsFunc(input);
-    }
+juce::Rectangle<int> TransferGraphComponent::getTextArea() const
+{
+    return getLocalBounds().reduced(8, 6).removeFromTop(32);
+}
 
-    Path functionPath;
+void TransferGraphComponent::paint(juce::Graphics& g)
+{
+    using namespace juce;
 
-    const double inputMax = graphArea.getRight();
-    const double outputMin = graphArea.getBottom();
-    const double outputMax = graphArea.getY();
-    auto map = [outputMin, outputMax](double input)
-        {
-            return jmap(input, 0.0, 1.0, outputMin, outputMax);
-        };
-    functionPath.startNewSubPath(graphArea.getX(), map(mags.front()));
+    CurveKey key;
+    key.distType = chainSettings.distType;
+    key.customCurveVersion = key.distType == DistTypes::Custom ? customCurveVersion : 0;
+    key.bypassed = chainSettings.distortionBypassed;
+    key.width = getWidth();
+    key.height = getHeight();
+    key.scale = g.getInternalContext().getPhysicalPixelScaleFactor();
 
-    for (size_t i = 1; i < mags.size(); ++i) {
-        functionPath.lineTo(graphArea.getX() + i, map(mags[i]));
-    }
+    if (key != curveKey || ! curveImage.isValid())
+        renderCurve(key);
 
-    int magX = jmap(static_cast<double>(dampedMagnitude), 0.0, aspectRatio, 0.0, inputMax);
-    int magY = map(static_cast<double>(wsFunc(dampedMagnitude)));
+    g.drawImage(curveImage, getLocalBounds().toFloat());
 
-    bool distBypassed = monoChain.isBypassed<ChainPositions::WaveShape>();
+    const double outputMin = getLocalBounds().getBottom();
+    const double outputMax = getLocalBounds().getY();
 
     g.setColour(Colours::lightblue);
-    if (distBypassed)
+    if (crosshair.bypassed)
     {
-        g.drawVerticalLine(magX, outputMax, outputMin);
+        g.drawVerticalLine(crosshair.x, outputMax, outputMin);
     }
     else
     {
-        g.drawHorizontalLine(magY, 0.0, magX);
-        g.drawVerticalLine(magX, magY, outputMin);
+        g.drawHorizontalLine(crosshair.y, 0.0, crosshair.x);
+        g.drawVerticalLine(crosshair.x, crosshair.y, outputMin);
     }
-    g.setColour(Colours::blue);
-    g.drawRoundedRectangle(graphArea.toFloat(), 4.f, 1.f);
-    if (distBypassed) g.setColour(Colours::grey);
-    else g.setColour(Colours::white);
-    g.strokePath(functionPath, PathStrokeType(2.f));
+
+    auto textArea = getTextArea();
+    g.setColour(Colours::lightgrey);
+    g.setFont(12.f);
+    g.drawText(inputText, textArea.removeFromTop(16), Justification::centredLeft);
+    g.drawText(outputText, textArea, Justification::centredLeft);
 }
 
 void TransferGraphComponent::resized()
+{
+    crosshair = getCrosshair();
+}
+
+void TransferGraphComponent::renderCurve(const CurveKey& key)
 {
     using namespace juce;
-    background = Image(Image::PixelFormat::RGB, getWidth(), getHeight(), true);
-    Graphics g(background);
 
-    float aspectRatio = static_cast<float>(getWidth()) / getHeight();
+    curveKey = key;
+    if (key.width <= 0 || key.height <= 0)
+    {
+        curveImage = {};
+        return;
+    }
+
+    // Rendered at the display's pixel density, so drawing it back is a
+    // straight copy.
+    curveImage = Image(Image::PixelFormat::RGB,
+        roundToInt(key.width * key.scale), roundToInt(key.height * key.scale), true);
+    Graphics g(curveImage);
+    g.addTransform(AffineTransform::scale(key.scale));
+    g.fillAll(Colours::black);
+
+    float aspectRatio = static_cast<float>(key.width) / key.height;
 
     Array<float> xAxis;
     for (int i = 0; i < aspectRatio; i++)
@@ -394,9 +472,9 @@ void TransferGraphComponent::resized()
     Line<float> l;
     for (auto a : xAxis)
     {
-        auto x = jmap(a, 0.f, aspectRatio, 0.f, float(getWidth()));
+        auto x = jmap(a, 0.f, aspectRatio, 0.f, float(key.width));
         l.setStart(x, 0.f);
-        l.setEnd(x, getHeight());
+        l.setEnd(x, key.height);
         if (fmod(a,1) == 0.f)
             g.drawDashedLine(l, dashPattern, 2, 2.f);
         else
@@ -408,13 +486,264 @@ void TransferGraphComponent::resized()
     };
     for (auto a : yAxis)
     {
-        auto y = jmap(a, 0.f, 1.f, 0.f, float(getHeight()));
+        auto y = jmap(a, 0.f, 1.f, 0.f, float(key.height));
         l.setStart(0.f, y);
-        l.setEnd(getWidth(), y);
+        l.setEnd(key.width, y);
         g.drawDashedLine(l, dashPattern, 2, 1.f);
     }
+
+    auto graphArea = Rectangle<int>(key.width, key.height);
+    auto wsFunc = [this, &key](float x) { return shape(key.distType, x); };
+
+    const double outputMin = graphArea.getBottom();
+    const double outputMax = graphArea.getY();
+    auto map = [outputMin, outputMax](double input)
+        {
+            return jmap(input, 0.0, 1.0, outputMin, outputMax);
+        };
+
+    // One point per physical pixel column.
+    auto numPoints = curveImage.getWidth();
+    Path functionPath;
+    functionPath.preallocateSpace(numPoints * 3);
+    functionPath.startNewSubPath(0.f, map(wsFunc(0.f)));
+
+    for (int i = 1; i < numPoints; ++i)
+    {
+        auto x = static_cast<float>(i) / key.scale;
+        functionPath.lineTo(x, map(wsFunc(aspectRatio * x / key.width)));
+    }
+
+    g.setColour(Colours::blue);
+    g.drawRoundedRectangle(graphArea.toFloat(), 4.f, 1.f);
+    if (key.bypassed) g.setColour(Colours::grey);
+    else g.setColour(Colours::white);
+    g.strokePath(functionPath, PathStrokeType(2.f));
+}
+
+//==============================================================================
+ScopeComponent::ScopeComponent(TestDistortionAudioProcessor& p) :
+    audioProcessor(p),
+    traces{ { { p.leftChannelFifo }, { p.rightChannelFifo } } }
+{
+}
+
+ScopeComponent::~ScopeComponent()
+{
+    for (auto& trace : traces)
+        trace.fifo.getRing().detachReader();
+}
+
+void ScopeComponent::visibilityChanged()
+{
+    if (isVisible())
+    {
+        for (auto& trace : traces)
+        {
+            trace.history.fill(0.f);
+            trace.writeIndex = 0;
+            trace.samplesSinceSignal = historySize;
+            trace.fifo.getRing().attachReader();
+        }
+
+        audioProcessor.setVisualisationMode(VisualisationModes::MetersAndSamples);
+        startTimerHz(refreshHz);
+    }
+    else
+    {
+        stopTimer();
+        audioProcessor.setVisualisationMode(VisualisationModes::MetersOnly);
+
+        for (auto& trace : traces)
+            trace.fifo.getRing().detachReader();
+    }
+}
+
+void ScopeComponent::timerCallback()
+{
+    auto changed = false;
+    for (auto& trace : traces)
+        changed = drain(trace) || changed;
+
+    if (changed)
+        repaint();
 }
 
+bool ScopeComponent::drain(Trace& trace)
+{
+    if (! trace.fifo.isPrepared())
+        return false;
+
+    auto& ring = trace.fifo.getRing();
+    auto spans = ring.getReadableSpans();
+    auto wasSilent = trace.samplesSinceSignal >= historySize;
+
+    auto append = [&trace](const float* data, int size)
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            trace.history[static_cast<size_t>(trace.writeIndex)] = data[i];
+            trace.writeIndex = (trace.writeIndex + 1) % historySize;
+            trace.samplesSinceSignal = data[i] != 0.f ? 0 : trace.samplesSinceSignal + 1;
+        }
+    };
+
+    append(spans.first, spans.firstSize);
+    append(spans.second, spans.secondSize);
+    ring.finishedReading(spans.getTotalSize());
+
+    return spans.getTotalSize() > 0 && ! (wasSilent && trace.samplesSinceSignal >= historySize);
+}
+
+void ScopeComponent::paint(juce::Graphics& g)
+{
+    using namespace juce;
+
+    auto bounds = getLocalBounds();
+    g.fillAll(Colours::black);
+    g.setColour(Colours::blue);
+    g.drawRoundedRectangle(bounds.toFloat(), 4.f, 1.f);
+
+    auto width = bounds.getWidth();
+    if (width <= 0)
+        return;
+
+    const auto top = static_cast<float>(bounds.getY() + 2);
+    const auto bottom = static_cast<float>(bounds.getBottom() - 2);
+    auto map = [top, bottom](float sample) { return jmap(jlimit(-1.f, 1.f, sample), -1.f, 1.f, bottom, top); };
+
+    // Right first, so the left is drawn over it; on a mono bus they match.
+    const Colour colours[] = { Colours::lightblue, Colours::blue.withAlpha(0.6f) };
+
+    for (int t = static_cast<int>(traces.size()) - 1; t >= 0; --t)
+    {
+        const auto& trace = traces[static_cast<size_t>(t)];
+        g.setColour(colours[t]);
+
+        // Oldest sample at the left edge.
+        for (int x = 0; x < width; ++x)
+        {
+            auto begin = x * historySize / width;
+            auto end = jmax(begin + 1, (x + 1) * historySize / width);
+
+            auto low = 1.f, high = -1.f;
+            for (int i = begin; i < end; ++i)
+            {
+                auto sample = trace.history[static_cast<size_t>((trace.writeIndex + i) % historySize)];
+                low = jmin(low, sample);
+                high = jmax(high, sample);
+            }
+
+            g.drawVerticalLine(bounds.getX() + x, map(high), map(low) + 1.f);
+        }
+    }
+}
+
+#if TESTDISTORTION_PROFILING
+//==============================================================================
+ProfilerPanel::ProfilerPanel(TestDistortionAudioProcessor& p) :
+    audioProcessor(p),
+    profiler(p.getProfiler())
+{
+    addAndMakeVisible(referencePathButton);
+    addAndMakeVisible(clearButton);
+    addAndMakeVisible(dumpButton);
+
+    referencePathButton.setToggleState(audioProcessor.getProcessingPath() == ProcessingPaths::ReferencePath, juce::dontSendNotification);
+    referencePathButton.onClick = [this]
+    {
+        auto reference = referencePathButton.getToggleState();
+        audioProcessor.setProcessingPath(reference ? ProcessingPaths::ReferencePath : ProcessingPaths::VectorPath);
+
+        // The paths split the work differently, so their counts don't mix.
+        profiler.clear();
+        repaint();
+    };
+
+    clearButton.onClick = [this] { profiler.clear(); repaint(); };
+    dumpButton.onClick = [this] { dump(); };
+
+    startTimerHz(refreshHz);
+}
+
+void ProfilerPanel::timerCallback()
+{
+    repaint();
+}
+
+void ProfilerPanel::paint(juce::Graphics& g)
+{
+    using namespace juce;
+
+    g.fillAll(Colours::black);
+    g.setColour(Colours::blue);
+    g.drawRoundedRectangle(getLocalBounds().toFloat().reduced(1.f), 4.f, 1.f);
+
+    auto microseconds = [](double nanoseconds) { return String(nanoseconds / 1000.0, 1); };
+
+    auto area = getLocalBounds().reduced(8);
+    area.removeFromBottom(clearButton.getHeight() + referencePathButton.getHeight() + 4);
+
+    auto lineHeight = 15;
+    auto drawLine = [&g, &area, lineHeight](const String& left, const String& right, Colour colour)
+    {
+        auto line = area.removeFromTop(lineHeight);
+        g.setColour(colour);
+        g.drawFittedText(left, line, Justification::centredLeft, 1);
+        g.drawFittedText(right, line, Justification::centredRight, 1);
+    };
+
+    g.setFont(12.f);
+
+    auto block = profiler.getBlockSummary();
+    auto misses = profiler.getNumDeadlineMisses();
+
+    drawLine("processBlock", "p50 / p99 / max us", Colours::grey);
+    drawLine("", microseconds(block.getPercentileNanoseconds(50)) + " / " + microseconds(block.getPercentileNanoseconds(99))
+                 + " / " + microseconds(static_cast<double>(block.maxNanoseconds)), Colours::white);
+    drawLine("Load avg / peak", String(profiler.getAverageLoad() * 100.0, 1) + "% / " + String(profiler.getPeakLoad() * 100.0, 1) + "%", Colours::white);
+    drawLine("Deadline misses", String(misses), misses > 0 ? Colours::red : Colours::white);
+
+    area.removeFromTop(lineHeight / 2);
+    drawLine("Stage", "mean / p99 us", Colours::grey);
+
+    for (int stage = 0; stage < ChainProfiler::maxStages; ++stage)
+    {
+        auto summary = profiler.getStageSummary(stage);
+        drawLine(profiler.getStageName(stage),
+                 microseconds(summary.getMeanNanoseconds()) + " / " + microseconds(summary.getPercentileNanoseconds(99)),
+                 Colours::white);
+    }
+}
+
+void ProfilerPanel::resized()
+{
+    auto area = getLocalBounds().reduced(8);
+    auto buttons = area.removeFromBottom(24);
+    referencePathButton.setBounds(area.removeFromBottom(24));
+    clearButton.setBounds(buttons.removeFromLeft(buttons.getWidth() / 2).reduced(2, 0));
+    dumpButton.setBounds(buttons.reduced(2, 0));
+}
+
+void ProfilerPanel::dump()
+{
+    chooser = std::make_unique<juce::FileChooser>("Save profile", juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                                                                      .getChildFile("testDistortion profile.txt"), "*.txt");
+
+    auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::warnAboutOverwriting;
+    chooser->launchAsync(flags, [this](const juce::FileChooser& fc)
+    {
+        auto file = fc.getResult();
+        if (file == juce::File())
+            return;
+
+        auto result = profiler.dumpToFile(file);
+        if (result.failed())
+            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Profile not saved", result.getErrorMessage());
+    });
+}
+#endif
+
 //==============================================================================
 TestDistortionAudioProcessorEditor::TestDistortionAudioProcessorEditor (TestDistortionAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p),
@@ -424,6 +753,7 @@ TestDistortionAudioProcessorEditor::TestDistortionAudioProcessorEditor (TestDist
     gainOutSlider(*audioProcessor.apvts.getParameter("Output Gain"), "dB"),
     waveshapeFunctionSlider(*audioProcessor.apvts.getParameter("Distortion Type"), ""),
     transferGraphComponent(audioProcessor),
+    scopeComponent(audioProcessor),
     lowCutSliderAttachment(audioProcessor.apvts, "LowCut Freq", lowCutSlider),
     highCutSliderAttachment(audioProcessor.apvts, "HighCut Freq", highCutSlider),
     gainInSliderAttachment(audioProcessor.apvts, "Input Gain", gainInSlider),
@@ -480,11 +810,30 @@ TestDistortionAudioProcessorEditor::TestDistortionAudioProcessorEditor (TestDist
             }
         };
 
-    setSize (600, 400);
+    // The graph only needs the levels. The scope starts hidden, and asks
+    // for the pre-shaper signal as well while it is shown.
+    audioProcessor.setVisualisationMode(VisualisationModes::MetersOnly);
+
+    addChildComponent(scopeComponent);
+    addAndMakeVisible(scopeButton);
+    scopeButton.onClick = [safePtr]()
+        {
+            if (auto* comp = safePtr.getComponent())
+                comp->scopeComponent.setVisible(comp->scopeButton.getToggleState());
+        };
+
+   #if TESTDISTORTION_PROFILING
+    addAndMakeVisible(profilerPanel);
+    setSize (600 + ProfilerPanel::width, 400 + ScopeComponent::height);
+   #else
+    setSize (600, 400 + ScopeComponent::height);
+   #endif
 }
 
 TestDistortionAudioProcessorEditor::~TestDistortionAudioProcessorEditor()
 {
+    audioProcessor.setVisualisationMode(VisualisationModes::NoVisualisation);
+
     lowCutBypassButton.setLookAndFeel(nullptr);
     highCutBypassButton.setLookAndFeel(nullptr);
     distortionBypassButton.setLookAndFeel(nullptr);
@@ -502,8 +851,14 @@ void TestDistortionAudioProcessorEditor::resized()
     // This is generally where you'll want to lay out the positions of any
     // subcomponents in your editor..
     auto bounds = getLocalBounds();
+   #if TESTDISTORTION_PROFILING
+    profilerPanel.setBounds(bounds.removeFromRight(ProfilerPanel::width));
+   #endif
     int controlAreaHeigh = bounds.getWidth() / 3;
     auto graphArea = bounds.removeFromTop(bounds.getHeight() - controlAreaHeigh);
+    auto scopeArea = graphArea.removeFromBottom(ScopeComponent::height);
+    scopeButton.setBounds(scopeArea.removeFromLeft(70).withSizeKeepingCentre(70, 24));
+    scopeComponent.setBounds(scopeArea);
     auto inputArea = bounds.removeFromLeft(bounds.getWidth() * 0.33);
     auto outputArea = bounds.removeFromRight(bounds.getWidth() * 0.5);
 
@@ -534,48 +889,3 @@ std::vector<juce::Component*> TestDistortionAudioProcessorEditor::getComps()
         &distortionBypassButton
     };
 }
-
-float arcTanFunc(float x)
-{
-    return atan(x * std::numbers::pi_v<float> / 2) * 2 / std::numbers::pi_v<float>;
-}
-
-float hypTanFunc(float x)
-{
-    return std::tanh(x);
-}
-
-float cubicFunc(float x)
-{
-    float temp;
-    if (x >= 1) temp = 2.f / 3;
-    else if (x <= -1) temp = -2.f / 3;
-    else temp = x - (std::pow(x, 3) / 3);
-    return temp;
-}
-
-float pow5Func(float x)
-{
-    float temp;
-    if (x >= 1) temp = 11.f / 15;
-    else if (x <= -1) temp = -11.f / 15;
-    else temp = x - (std::pow(x, 3) / 6) - (std::pow(x, 5) / 10);
-    return temp;
-}
-
-float pow7Func(float x)
-{
-    float temp;
-    if (x >= 1) temp = 19.f / 24;
-    else if (x <= -1) temp = -19.f / 24;
-    else temp = x - (std::pow(x, 3) / 12) - (std::pow(x, 5) / 16) - (std::pow(x, 7) / 16);
-    return temp;
-}
-
-float hardFunc(float x)
-{
-    float temp = x;
-    if (temp >= 1) temp = 1.f;
-    else if (temp <= -1) temp = -1.f;
-    return (temp);
-}
\ No newline at end of file
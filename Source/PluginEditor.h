@@ -12,35 +12,127 @@
 #include "PluginProcessor.h"
 #include <array>
 
-float arcTanFunc(float);
-float hypTanFunc(float);
-float cubicFunc(float);
-float pow5Func(float);
-float pow7Func(float);
-float hardFunc(float);
-
-struct TransferGraphComponent : juce::Component, juce::AudioProcessorParameter::Listener, juce::Timer
+struct TransferGraphComponent : juce::Component, juce::Timer, juce::FileDragAndDropTarget, juce::ChangeListener
 {
+    // The timer stops once nothing has changed for ticksBeforeIdle ticks,
+    // and the processor starts it again when a parameter, the curve or the
+    // meters change.
+    static constexpr int activeHz = 60;
+    static constexpr int ticksBeforeIdle = 30;
+
     TransferGraphComponent(TestDistortionAudioProcessor&);
-    ~TransferGraphComponent();
-    void parameterValueChanged(int parameterIndex, float newValue) override;
-    void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override {};
+    ~TransferGraphComponent() override;
     void timerCallback() override;
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
     void paint(juce::Graphics& g) override;
     void resized() override;
-    void updateChain();
+    bool updateSettings();
+
+    // Dropping a curve file on the graph loads it and selects Custom.
+    bool isInterestedInFileDrag(const juce::StringArray& files) override;
+    void filesDropped(const juce::StringArray& files, int x, int y) override;
 private:
+    // Everything the cached curve image depends on.
+    struct CurveKey
+    {
+        DistTypes distType{ DistTypes::ArcTan };
+        juce::uint32 customCurveVersion = 0;
+        bool bypassed = false;
+        int width = 0, height = 0;
+        float scale = 0.f;
+
+        bool operator==(const CurveKey&) const = default;
+    };
+
+    struct Crosshair
+    {
+        int x = 0, y = 0;
+        bool bypassed = false;
+
+        bool operator==(const Crosshair&) const = default;
+    };
+
+    // Custom is read from the same table the audio thread plays.
+    float shape(DistTypes distType, float x) const;
+
+    void stopUntilActivity();
+    void renderCurve(const CurveKey& key);
+    Crosshair getCrosshair() const;
+    void repaintCrosshair(const Crosshair& crosshair);
+    juce::Rectangle<int> getTextArea() const;
+
     TestDistortionAudioProcessor& audioProcessor;
-    juce::Atomic<bool> parametersChanged{ false };
-    MonoChain monoChain;
-    juce::Image background;
-
-    SingleChannelSampleFifo<TestDistortionAudioProcessor::BlockType>* leftChannelFifo;
-    SingleChannelSampleFifo<TestDistortionAudioProcessor::BlockType>* rightChannelFifo;
-    float maxMagnitude;
-    float dampedMagnitude;
+    ChainSettings chainSettings;
+    juce::uint32 settingsVersion = 0;
+    juce::uint32 customCurveVersion = 0;
+
+    juce::Image curveImage;
+    CurveKey curveKey;
+    Crosshair crosshair;
+
+    MeterLevels inputLevels, outputLevels;
+    juce::String inputText, outputText;
+    float maxMagnitude = 0.f;
+    float dampedMagnitude = 0.f;
+    int quietTicks = 0;
 };
 
+// The pre-shaper signal of each side over the last few tens of
+// milliseconds, drawn as a min/max envelope per pixel column. It is the
+// only reader of the processor's sample rings, and only while it is
+// visible: showing it turns the sample capture on, hiding it turns it off.
+struct ScopeComponent : juce::Component, juce::Timer
+{
+    static constexpr int height = 60;
+    static constexpr int refreshHz = 30;
+    static constexpr int historySize = 4096;
+
+    explicit ScopeComponent(TestDistortionAudioProcessor&);
+    ~ScopeComponent() override;
+    void visibilityChanged() override;
+    void timerCallback() override;
+    void paint(juce::Graphics& g) override;
+private:
+    struct Trace
+    {
+        SingleChannelSampleFifo<TestDistortionAudioProcessor::BlockType>& fifo;
+        std::array<float, historySize> history{};
+        int writeIndex = 0;
+        int samplesSinceSignal = historySize;
+    };
+
+    // Copies whatever the ring holds into the history and hands it back.
+    // Returns false if the trace was silent and still is.
+    bool drain(Trace& trace);
+
+    TestDistortionAudioProcessor& audioProcessor;
+    std::array<Trace, 2> traces;
+};
+
+#if TESTDISTORTION_PROFILING
+// The processor's stage and block timings, refreshed a few times a second,
+// with buttons to start the counts again and to dump them to a file. The
+// toggle switches to the reference path, so the two can be compared.
+struct ProfilerPanel : juce::Component, juce::Timer
+{
+    static constexpr int width = 220;
+    static constexpr int refreshHz = 4;
+
+    explicit ProfilerPanel(TestDistortionAudioProcessor&);
+    void timerCallback() override;
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+private:
+    void dump();
+
+    TestDistortionAudioProcessor& audioProcessor;
+    ChainProfiler& profiler;
+    juce::ToggleButton referencePathButton{ "Reference path" };
+    juce::TextButton clearButton{ "Clear" }, dumpButton{ "Dump..." };
+    std::unique_ptr<juce::FileChooser> chooser;
+};
+#endif
+
 //==============================================================================
 /**
 */
@@ -112,6 +204,8 @@ private:
         gainOutSlider, waveshapeFunctionSlider;
 
     TransferGraphComponent transferGraphComponent;
+    ScopeComponent scopeComponent;
+    juce::ToggleButton scopeButton{ "Scope" };
 
     using APVTS = juce::AudioProcessorValueTreeState;
     using Attachment = APVTS::SliderAttachment;
@@ -131,5 +225,9 @@ private:
 
     LookAndFeel lnf;
 
+   #if TESTDISTORTION_PROFILING
+    ProfilerPanel profilerPanel{ audioProcessor };
+   #endif
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TestDistortionAudioProcessorEditor)
 };
@@ -8,8 +8,52 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "AllocationTracker.h"
 #include <numbers>
 #include <cmath>
+#include <thread>
+
+namespace
+{
+    struct ParameterStage
+    {
+        const char* parameterID;
+        int stage;
+    };
+
+    const ParameterStage parameterStages[]
+    {
+        { "LowCut Freq", DirtyStages::LowCutDirty },
+        { "LowCut Slope", DirtyStages::LowCutDirty },
+        { "LowCut Bypassed", DirtyStages::LowCutDirty },
+        { "HighCut Freq", DirtyStages::HighCutDirty },
+        { "HighCut Slope", DirtyStages::HighCutDirty },
+        { "HighCut Bypassed", DirtyStages::HighCutDirty },
+        { "Input Gain", DirtyStages::GainDirty },
+        { "Output Gain", DirtyStages::GainDirty },
+        { "Distortion Type", DirtyStages::ShaperDirty },
+        { "Curve Accuracy", DirtyStages::ShaperDirty },
+        { "Distortion Bypassed", DirtyStages::ShaperDirty },
+        { "Oversampling", DirtyStages::AntialiasingDirty },
+        { "Oversampling Filter", DirtyStages::AntialiasingDirty },
+        { "Antialiasing", DirtyStages::AntialiasingDirty },
+        { "Bands", DirtyStages::MultibandDirty },
+        { "Crossover 1 Freq", DirtyStages::MultibandDirty },
+        { "Crossover 2 Freq", DirtyStages::MultibandDirty },
+        { "Crossover 3 Freq", DirtyStages::MultibandDirty },
+        { "Band 1 Gain", DirtyStages::MultibandDirty },
+        { "Band 2 Gain", DirtyStages::MultibandDirty },
+        { "Band 3 Gain", DirtyStages::MultibandDirty },
+        { "Band 4 Gain", DirtyStages::MultibandDirty },
+        { "Band 1 Type", DirtyStages::MultibandDirty },
+        { "Band 2 Type", DirtyStages::MultibandDirty },
+        { "Band 3 Type", DirtyStages::MultibandDirty },
+        { "Band 4 Type", DirtyStages::MultibandDirty }
+    };
+
+    // The source text of the custom curve, kept alongside the parameters.
+    const juce::Identifier customCurveProperty{ "CustomCurve" };
+}
 
 //==============================================================================
 TestDistortionAudioProcessor::TestDistortionAudioProcessor()
@@ -24,10 +68,14 @@ TestDistortionAudioProcessor::TestDistortionAudioProcessor()
                        )
 #endif
 {
+    for (const auto& entry : parameterStages)
+        apvts.addParameterListener(entry.parameterID, this);
 }
 
 TestDistortionAudioProcessor::~TestDistortionAudioProcessor()
 {
+    for (const auto& entry : parameterStages)
+        apvts.removeParameterListener(entry.parameterID, this);
 }
 
 //==============================================================================
@@ -65,31 +113,49 @@ bool TestDistortionAudioProcessor::isMidiEffect() const
 
 double TestDistortionAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return getFilterTailSeconds(parameterSnapshot.read());
 }
 
 int TestDistortionAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    // Some hosts don't cope with 0 programs; the bank always has its factory presets.
+    return juce::jmax(1, presetBank.getNumPresets());
 }
 
 int TestDistortionAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram.load();
 }
 
 void TestDistortionAudioProcessor::setCurrentProgram (int index)
 {
+    auto* preset = presetBank.getPreset(index);
+    if (preset == nullptr)
+        return;
+
+    currentProgram.store(index);
+    presetSwitch.request(*preset);
+
+    // The audio thread already has the settings; the parameters are for the
+    // host and the editor. Hosts may call this on any thread.
+    presetToSync.store(preset);
+    triggerAsyncUpdate();
+
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        handleUpdateNowIfNeeded();
 }
 
 const juce::String TestDistortionAudioProcessor::getProgramName (int index)
 {
+    if (auto* preset = presetBank.getPreset(index))
+        return preset->name;
+
     return {};
 }
 
 void TestDistortionAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    presetBank.setName(index, newName);
 }
 
 //==============================================================================
@@ -100,14 +166,68 @@ void TestDistortionAudioProcessor::prepareToPlay (double sampleRate, int samples
 
     juce::dsp::ProcessSpec spec;
 
-    spec.maximumBlockSize = samplesPerBlock;
+    // Everything is sized for one sub-block, whatever the host block size.
+    preparedSubBlockSize = subBlockSize.load();
+    samplePosition = 0;
+
+    spec.maximumBlockSize = static_cast<juce::uint32>(preparedSubBlockSize);
     spec.numChannels = 1;
     spec.sampleRate = sampleRate;
 
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    auto numChannels = getTotalNumOutputChannels();
+    auto doublePrecision = isUsingDoublePrecision();
+
+    // The host picks the precision before preparing, so only one set of
+    // chains is ever in use.
+    chains.clear();
+    doubleChains.clear();
+
+    if (doublePrecision)
+        doubleChains.resize(static_cast<size_t>(numChannels));
+    else
+        chains.resize(static_cast<size_t>(numChannels));
+
+    // The new chains start on the default curve until the first block.
+    appliedCustomCurve = nullptr;
+
+    forEachChain([this, &spec](auto& chain)
+    {
+        chain.prepare(spec);
+        chain.template get<ChainPositions::GainIn>().setRampDurationSeconds(CutoffSmoother<float>::defaultRampSeconds);
+        chain.template get<ChainPositions::GainOut>().setRampDurationSeconds(CutoffSmoother<float>::defaultRampSeconds);
+        profiler.attach(chain);
+    });
+
+    spec.numChannels = static_cast<juce::uint32>(numChannels);
+    if (! doublePrecision)
+    {
+        vectorChain.prepare(spec);
+        vectorChain.setProfiler(&profiler);
+    }
+
+    // Mono and stereo are cheap enough that waking other threads would cost
+    // more than it saves. Wider buses get one worker per extra channel, up
+    // to the number of cores.
+    auto numCores = static_cast<int>(std::thread::hardware_concurrency());
+    workerPool.start(numChannels > 2 ? juce::jmin(numChannels, numCores) - 1 : 0, sampleRate, preparedSubBlockSize, audioWorkgroup);
+
+    // A switch left over from before has nothing to fade: its parameters
+    // are in the snapshot by now, or on their way.
+    presetSwitch.prepare(sampleRate);
+    presetSwitch.takePending();
+
+    parameterSnapshot.markChanged(DirtyStages::AllDirty);
+    updateDirtyStages();
 
-    updateChain();
+    // Start from the current settings rather than gliding in from defaults.
+    forEachChain([](auto& chain) { chain.reset(); });
+    vectorChain.reset();
+
+    auto chainSettings = parameterSnapshot.read();
+    setLatencySamples(getShaperLatency(chainSettings));
+    silenceGate.prepare(getSilenceHoldSamples(chainSettings));
+
+    fifoBuffer.setSize(juce::jmin(numChannels, 2), preparedSubBlockSize, false, true, false);
 
     leftChannelFifo.prepare(samplesPerBlock);
     rightChannelFifo.prepare(samplesPerBlock);
@@ -117,6 +237,12 @@ void TestDistortionAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    workerPool.stop();
+}
+
+void TestDistortionAudioProcessor::audioWorkgroupContextChanged (const juce::AudioWorkgroup& workgroup)
+{
+    audioWorkgroup = workgroup;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -126,12 +252,9 @@ bool TestDistortionAudioProcessor::isBusesLayoutSupported (const BusesLayout& la
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Every channel gets its own chain, so any layout works as long as
+    // there is one.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -146,8 +269,32 @@ bool TestDistortionAudioProcessor::isBusesLayoutSupported (const BusesLayout& la
 #endif
 
 void TestDistortionAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused(midiMessages);
+    processSamples(buffer);
+}
+
+void TestDistortionAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused(midiMessages);
+    processSamples(buffer);
+}
+
+template<typename SampleType>
+void TestDistortionAudioProcessor::processSamples(juce::AudioBuffer<SampleType>& buffer)
 {
     juce::ScopedNoDenormals noDenormals;
+    AllocationTracker::ScopedRealtimeSection realtimeSection;
+
+   #if TESTDISTORTION_TRACK_ALLOCATIONS
+    if (allocationProbe.exchange(false))
+    {
+        juce::AudioBuffer<SampleType> scratch(juce::jmax(1, buffer.getNumChannels()), juce::jmax(1, buffer.getNumSamples()));
+        scratch.clear();
+    }
+   #endif
+
+    ChainProfiler::ScopedBlock profiledBlock(profiler, buffer.getNumSamples(), getSampleRate());
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -160,24 +307,185 @@ void TestDistortionAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
-    updateChain();
+    updateDirtyStages();
+
+    auto* customCurve = customCurves.acquire();
+    if (customCurve != appliedCustomCurve)
+    {
+        forEachChain([customCurve](auto& chain) { chain.template get<ChainPositions::WaveShape>().setCustomCurve(customCurve); });
+        vectorChain.setCustomCurve(customCurve);
+        appliedCustomCurve = customCurve;
+    }
+
+    auto mode = visualisationMode.load(std::memory_order_relaxed);
+    auto metering = mode != VisualisationModes::NoVisualisation;
+    auto capturingSamples = mode == VisualisationModes::MetersAndSamples;
+
+    // VectorChain is float only.
+    auto usesVectorChain = std::is_same_v<SampleType, float> && processingPath.load() == ProcessingPaths::VectorPath;
+    auto& channelChains = getChains<SampleType>();
+
+    if (usesVectorChain)
+    {
+        vectorChain.setMeteringEnabled(metering);
+        vectorChain.setPreShaperCaptureEnabled(capturingSamples);
+    }
+    else
+    {
+        for (auto& chain : channelChains)
+        {
+            chain.template setBypassed<ChainPositions::FifoBlk>(! capturingSamples);
+            chain.template setBypassed<ChainPositions::PreMeter>(! metering);
+            chain.template setBypassed<ChainPositions::PostMeter>(! metering);
+        }
+    }
+
+    juce::dsp::AudioBlock<SampleType> block(buffer);
+    auto numSamples = static_cast<int>(block.getNumSamples());
+
+    for (int start = 0; start < numSamples;)
+    {
+        auto offset = static_cast<int>(samplePosition % static_cast<juce::uint64>(preparedSubBlockSize));
+        auto length = juce::jmin(numSamples - start, preparedSubBlockSize - offset);
+        auto subBlock = block.getSubBlock(static_cast<size_t>(start), static_cast<size_t>(length));
+
+        if (silenceGate.shouldProcess(SilenceGate::isSilent(subBlock), length))
+        {
+            // Asleep, the chain was left holding a few denormal-sized
+            // states; start it again from clean.
+            if (silenceGate.takeWakeUp())
+            {
+                forEachChain([](auto& chain) { chain.reset(); });
+                vectorChain.reset();
+            }
+
+            processSubBlock(subBlock, usesVectorChain, capturingSamples);
+
+            if (auto* preset = presetSwitch.process(subBlock))
+                applyPreset(*preset);
+
+            silenceGate.processed(SilenceGate::isSilent(subBlock));
+        }
+        else
+        {
+            subBlock.clear();
+
+            if (auto* preset = presetSwitch.takePending())
+                applyPreset(*preset);
+
+            // Keep the editor's scope scrolling.
+            if (capturingSamples)
+            {
+                fifoBuffer.clear();
+                leftChannelFifo.update(fifoBuffer, length);
+                rightChannelFifo.update(fifoBuffer, length);
+            }
+        }
+
+        start += length;
+        samplePosition += static_cast<juce::uint64>(length);
+    }
+
+    if (! metering)
+        return;
+
+    if (usesVectorChain)
+    {
+        publishMeters(vectorChain.getMeterLevels(MeterPoints::PreShaperPoint),
+                      vectorChain.getMeterLevels(MeterPoints::PostShaperPoint));
+        return;
+    }
+
+    auto numChannels = juce::jmin(static_cast<int>(block.getNumChannels()), static_cast<int>(channelChains.size()));
+
+    MeterLevels preShaper, postShaper;
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        preShaper.combine(channelChains[static_cast<size_t>(ch)].template get<ChainPositions::PreMeter>().getLevels());
+        postShaper.combine(channelChains[static_cast<size_t>(ch)].template get<ChainPositions::PostMeter>().getLevels());
+    }
+
+    publishMeters(preShaper, postShaper);
+}
+
+void TestDistortionAudioProcessor::publishMeters(const MeterLevels& preShaper, const MeterLevels& postShaper) noexcept
+{
+    // Stored separately so one changing can't skip storing the other.
+    auto preChanged = meters[MeterPoints::PreShaperPoint].store(preShaper);
+    auto postChanged = meters[MeterPoints::PostShaperPoint].store(postShaper);
+
+    if (preChanged || postChanged)
+        wakeEditor();
+}
 
-    juce::dsp::AudioBlock<float> block(buffer);
+void TestDistortionAudioProcessor::sleepUntilActivity() noexcept
+{
+    editorAsleep.store(true);
+
+    // Pairs with the fence in wakeEditor(): either the editor's next look
+    // at the levels and versions sees the change, or this sees the flag.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void TestDistortionAudioProcessor::wakeEditor() noexcept
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // The load keeps the audio thread to a plain read while the editor is
+    // awake or closed.
+    if (editorAsleep.load(std::memory_order_relaxed) && editorAsleep.exchange(false))
+        activityBroadcaster.sendChangeMessage();
+}
+
+void TestDistortionAudioProcessor::processSubBlock(juce::dsp::AudioBlock<float> block, bool usesVectorChain, bool capturingSamples) noexcept
+{
+    if (! usesVectorChain)
+    {
+        processReferencePath(block, chains, capturingSamples);
+        return;
+    }
 
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    vectorChain.process(block, workerPool);
 
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    if (capturingSamples)
+    {
+        auto numSamples = static_cast<int>(block.getNumSamples());
+        leftChannelFifo.update(vectorChain.getPreShaperBuffer(), numSamples);
+        rightChannelFifo.update(vectorChain.getPreShaperBuffer(), numSamples);
+    }
+}
 
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+void TestDistortionAudioProcessor::processSubBlock(juce::dsp::AudioBlock<double> block, bool usesVectorChain, bool capturingSamples) noexcept
+{
+    jassert(! usesVectorChain);
+    juce::ignoreUnused(usesVectorChain);
 
-    juce::AudioBuffer<float> fifoBuffer(buffer.getNumChannels(), buffer.getNumSamples());
-    fifoBuffer.copyFrom(0, 0, leftChain.get<ChainPositions::FifoBlk>().getBuffer().getReadPointer(0), leftChain.get<ChainPositions::FifoBlk>().getNumSamples());
-    fifoBuffer.copyFrom(1, 0, rightChain.get<ChainPositions::FifoBlk>().getBuffer().getReadPointer(0), rightChain.get<ChainPositions::FifoBlk>().getNumSamples());
-    leftChannelFifo.update(fifoBuffer);
-    rightChannelFifo.update(fifoBuffer);
+    processReferencePath(block, doubleChains, capturingSamples);
+}
+
+template<typename SampleType>
+void TestDistortionAudioProcessor::processReferencePath(juce::dsp::AudioBlock<SampleType> block, std::vector<MonoChain<SampleType>>& channelChains,
+                                                        bool capturingSamples) noexcept
+{
+    auto numChannels = juce::jmin(static_cast<int>(block.getNumChannels()), static_cast<int>(channelChains.size()));
+    auto numSamples = static_cast<int>(block.getNumSamples());
+
+    auto processChannel = [&channelChains, &block](int channel)
+    {
+        auto channelBlock = block.getSingleChannelBlock(static_cast<size_t>(channel));
+        juce::dsp::ProcessContextReplacing<SampleType> context(channelBlock);
+        channelChains[static_cast<size_t>(channel)].process(context);
+    };
+    workerPool.run(numChannels, processChannel);
+
+    if (capturingSamples)
+    {
+        for (int ch = 0; ch < juce::jmin(fifoBuffer.getNumChannels(), numChannels); ++ch)
+            fifoBuffer.copyFrom(ch, 0, channelChains[static_cast<size_t>(ch)].template get<ChainPositions::FifoBlk>().getBuffer(), 0, 0, numSamples);
+
+        leftChannelFifo.update(fifoBuffer, numSamples);
+        rightChannelFifo.update(fifoBuffer, numSamples);
+    }
 }
 
 //==============================================================================
@@ -198,8 +506,22 @@ void TestDistortionAudioProcessor::getStateInformation (juce::MemoryBlock& destD
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
+    auto state = apvts.copyState();
+    juce::String curveSource;
+
+    {
+        // A restored curve that hasn't been loaded yet is the one to save.
+        const juce::ScopedLock lock(curveSourceLock);
+        curveSource = curveToRestore.value_or(publishedCurveSource);
+    }
+
+    if (curveSource.isNotEmpty())
+        state.setProperty(customCurveProperty, curveSource, nullptr);
+    else
+        state.removeProperty(customCurveProperty, nullptr);
+
     juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    state.writeToStream(mos);
 }
 
 void TestDistortionAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -210,85 +532,280 @@ void TestDistortionAudioProcessor::setStateInformation (const void* data, int si
     if (tree.isValid())
     {
         apvts.replaceState(tree);
-        updateChain();
+        parameterSnapshot.markChanged(DirtyStages::AllDirty);
+
+        // Hosts may restore state on any thread, while the editor draws the
+        // current curve, so the curve is swapped on the message thread.
+        {
+            const juce::ScopedLock lock(curveSourceLock);
+            curveToRestore = tree.getProperty(customCurveProperty).toString();
+        }
+
+        triggerAsyncUpdate();
+
+        if (juce::MessageManager::existsAndIsCurrentThread())
+            handleUpdateNowIfNeeded();
     }
 }
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+void TestDistortionAudioProcessor::restoreCustomCurve(const juce::String& curveSource)
 {
-    ChainSettings settings;
+    if (curveSource == customCurves.getCurrent().getSource())
+        return;
 
-    settings.lowFreq = apvts.getRawParameterValue("LowCut Freq")->load();
-    settings.highFreq = apvts.getRawParameterValue("HighCut Freq")->load();
-    settings.inGain = apvts.getRawParameterValue("Input Gain")->load();
-    settings.outGain = apvts.getRawParameterValue("Output Gain")->load();
-    settings.distType = static_cast<DistTypes>(apvts.getRawParameterValue("Distortion Type")->load());
+    if (curveSource.isEmpty() || loadCustomCurve(curveSource).failed())
+        publishCustomCurve(std::make_unique<CustomCurveTable>(CustomCurveTable::getDefault()));
+}
 
-    settings.lowCutBypassed = apvts.getRawParameterValue("LowCut Bypassed")->load() > 0.5f;
-    settings.highCutBypassed = apvts.getRawParameterValue("HighCut Bypassed")->load() > 0.5f;
-    settings.distortionBypassed = apvts.getRawParameterValue("Distortion Bypassed")->load() > 0.5f;
+void TestDistortionAudioProcessor::publishCustomCurve(std::unique_ptr<CustomCurveTable> table)
+{
+    {
+        const juce::ScopedLock lock(curveSourceLock);
+        publishedCurveSource = table->getSource();
+    }
 
-    return settings;
+    customCurves.publish(std::move(table));
+    wakeEditor();
 }
 
-void TestDistortionAudioProcessor::updateCoefficients(Coefficients& old, const Coefficients& replacements)
+juce::Result TestDistortionAudioProcessor::loadCustomCurve(const juce::File& file)
 {
-    *old = *replacements;
+    std::unique_ptr<CustomCurveTable> table;
+    auto result = CustomCurveLoader::load(file, table);
+
+    if (result.wasOk())
+        publishCustomCurve(std::move(table));
+
+    return result;
 }
 
-void TestDistortionAudioProcessor::updateLowCut(const ChainSettings& chainSettings)
+juce::Result TestDistortionAudioProcessor::loadCustomCurve(const juce::String& text)
 {
-    auto lowCutCoefficients = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowFreq, getSampleRate(), 1);
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
+    std::unique_ptr<CustomCurveTable> table;
+    auto result = CustomCurveLoader::parse(text, table);
 
-    leftChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    rightChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
+    if (result.wasOk())
+        publishCustomCurve(std::move(table));
 
-    updateCoefficients(leftLowCut.get<0>().coefficients, lowCutCoefficients[0]);
-    updateCoefficients(rightLowCut.get<0>().coefficients, lowCutCoefficients[0]);
+    return result;
 }
 
-void TestDistortionAudioProcessor::updateHighCut(const ChainSettings& chainSettings)
+void TestDistortionAudioProcessor::updateLowCut(const ChainSettings& chainSettings)
 {
-    auto highCutCoefficients = juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highFreq, getSampleRate(), 1);
-    auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
-
-    leftChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
-    rightChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
+    forEachChain([&chainSettings](auto& chain)
+    {
+        chain.template setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
+        chain.template get<ChainPositions::LowCut>().setCutoffFrequency(chainSettings.lowFreq);
+        chain.template get<ChainPositions::LowCut>().setSlope(chainSettings.lowCutSlope);
+    });
+
+    vectorChain.setLowCutBypassed(chainSettings.lowCutBypassed);
+    vectorChain.setLowCutFrequency(chainSettings.lowFreq);
+    vectorChain.setLowCutSlope(chainSettings.lowCutSlope);
+}
 
-    updateCoefficients(leftHighCut.get<0>().coefficients, highCutCoefficients[0]);
-    updateCoefficients(rightHighCut.get<0>().coefficients, highCutCoefficients[0]);
+void TestDistortionAudioProcessor::updateHighCut(const ChainSettings& chainSettings)
+{
+    forEachChain([&chainSettings](auto& chain)
+    {
+        chain.template setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
+        chain.template get<ChainPositions::HighCut>().setCutoffFrequency(chainSettings.highFreq);
+        chain.template get<ChainPositions::HighCut>().setSlope(chainSettings.highCutSlope);
+    });
+
+    vectorChain.setHighCutBypassed(chainSettings.highCutBypassed);
+    vectorChain.setHighCutFrequency(chainSettings.highFreq);
+    vectorChain.setHighCutSlope(chainSettings.highCutSlope);
 }
 
 void TestDistortionAudioProcessor::updateGain(const ChainSettings& chainSettings)
 {
-    leftChain.get<ChainPositions::GainIn>().setGainDecibels(chainSettings.inGain);
-    rightChain.get<ChainPositions::GainIn>().setGainDecibels(chainSettings.inGain);
-    leftChain.get<ChainPositions::GainOut>().setGainDecibels(chainSettings.outGain);
-    rightChain.get<ChainPositions::GainOut>().setGainDecibels(chainSettings.outGain);
+    forEachChain([&chainSettings](auto& chain)
+    {
+        chain.template get<ChainPositions::GainIn>().setGainDecibels(chainSettings.inGain);
+        chain.template get<ChainPositions::GainOut>().setGainDecibels(chainSettings.outGain);
+    });
+
+    vectorChain.setInputGainDecibels(chainSettings.inGain);
+    vectorChain.setOutputGainDecibels(chainSettings.outGain);
 }
 
 void TestDistortionAudioProcessor::updateWaveShaper(const ChainSettings& chainSettings)
 {
-    auto& waveshapeLeft = leftChain.get<ChainPositions::WaveShape>();
-    auto& waveshapeRight = rightChain.get<ChainPositions::WaveShape>();
+    forEachChain([&chainSettings](auto& chain)
+    {
+        chain.template setBypassed<ChainPositions::WaveShape>(chainSettings.distortionBypassed);
+        chain.template get<ChainPositions::WaveShape>().setDistType(chainSettings.distType);
+        chain.template get<ChainPositions::WaveShape>().setAccuracyTier(chainSettings.accuracyTier);
+    });
+
+    vectorChain.setDistortionBypassed(chainSettings.distortionBypassed);
+    vectorChain.setDistType(chainSettings.distType);
+    vectorChain.setAccuracyTier(chainSettings.accuracyTier);
+}
+
+void TestDistortionAudioProcessor::updateAntialiasing(const ChainSettings& chainSettings)
+{
+    forEachChain([&chainSettings](auto& chain)
+    {
+        auto& waveshape = chain.template get<ChainPositions::WaveShape>();
+        waveshape.setOversampling(chainSettings.oversamplingOrder, chainSettings.linearPhaseOversampling);
+        waveshape.setAntialiasing(chainSettings.antialiasing);
+    });
+
+    vectorChain.setOversampling(chainSettings.oversamplingOrder, chainSettings.linearPhaseOversampling);
+    vectorChain.setAntialiasing(chainSettings.antialiasing);
+}
 
-    leftChain.setBypassed<ChainPositions::WaveShape>(chainSettings.distortionBypassed);
-    rightChain.setBypassed<ChainPositions::WaveShape>(chainSettings.distortionBypassed);
+void TestDistortionAudioProcessor::updateMultiband(const ChainSettings& chainSettings)
+{
+    forEachChain([&chainSettings](auto& chain)
+    {
+        chain.template get<ChainPositions::WaveShape>().setMultiband(chainSettings.multiband);
+    });
 
-    updateWaveShape(waveshapeLeft, chainSettings.distType);
-    updateWaveShape(waveshapeRight, chainSettings.distType);
+    vectorChain.setMultiband(chainSettings.multiband);
 }
 
-void TestDistortionAudioProcessor::updateChain()
+int TestDistortionAudioProcessor::getShaperLatency(const ChainSettings& chainSettings) const
 {
-    auto chainSettings = getChainSettings(apvts);
-    updateHighCut(chainSettings);
-    updateLowCut(chainSettings);
-    updateGain(chainSettings);
-    updateWaveShaper(chainSettings);
+    auto order = chainSettings.oversamplingOrder;
+    auto linearPhase = chainSettings.linearPhaseOversampling;
+    auto antialiasing = Waveshaper<float>::getEffectiveAntialiasing(chainSettings.antialiasing, chainSettings.multiband.numBands);
+
+    if (! chains.empty())
+        return chains.front().get<ChainPositions::WaveShape>().getLatencyInSamples(order, linearPhase, antialiasing);
+    if (! doubleChains.empty())
+        return doubleChains.front().get<ChainPositions::WaveShape>().getLatencyInSamples(order, linearPhase, antialiasing);
+
+    return 0;
+}
+
+double TestDistortionAudioProcessor::getFilterTailSeconds(const ChainSettings& chainSettings) const
+{
+    // The shaper and gains have no memory to speak of, so the tail is how
+    // long the cut filters and any crossovers ring, down to the silence
+    // threshold.
+    auto attenuation = -SilenceGate::thresholdDecibels;
+    auto seconds = 0.0;
+
+    if (! chainSettings.distortionBypassed)
+        seconds += MultibandShaper::getDecaySeconds(chainSettings.multiband, attenuation);
+
+    if (! chainSettings.lowCutBypassed)
+        seconds += CutSlopeLayout::forSlope(chainSettings.lowCutSlope).getDecaySeconds(chainSettings.lowFreq, attenuation);
+    if (! chainSettings.highCutBypassed)
+        seconds += CutSlopeLayout::forSlope(chainSettings.highCutSlope).getDecaySeconds(chainSettings.highFreq, attenuation);
+
+    return seconds;
+}
+
+int TestDistortionAudioProcessor::getSilenceHoldSamples(const ChainSettings& chainSettings) const
+{
+    auto tailSamples = static_cast<int>(std::ceil(getFilterTailSeconds(chainSettings) * getSampleRate()));
+    return tailSamples + getShaperLatency(chainSettings);
+}
+
+void TestDistortionAudioProcessor::updateDirtyStages()
+{
+    auto dirty = parameterSnapshot.takeChangedStages();
+    if (dirty == 0)
+        return;
+
+    // Changes made during a preset switch wait for the swap, so nothing
+    // moves while the old settings fade out. Checked after taking the
+    // stages, so the parameter sync that follows a request can't slip in
+    // ahead of it.
+    if (presetSwitch.isSwitching())
+    {
+        parameterSnapshot.restoreChangedStages(dirty);
+        return;
+    }
+
+    // Only fails while a listener is mid-publish, and that publish flags
+    // its stages again, so trying next block is enough.
+    ChainSettings chainSettings;
+    if (! parameterSnapshot.tryRead(chainSettings))
+    {
+        parameterSnapshot.restoreChangedStages(dirty);
+        return;
+    }
+
+    if (dirty & DirtyStages::HighCutDirty)
+        updateHighCut(chainSettings);
+    if (dirty & DirtyStages::LowCutDirty)
+        updateLowCut(chainSettings);
+    if (dirty & DirtyStages::GainDirty)
+        updateGain(chainSettings);
+    if (dirty & DirtyStages::ShaperDirty)
+        updateWaveShaper(chainSettings);
+    if (dirty & DirtyStages::AntialiasingDirty)
+        updateAntialiasing(chainSettings);
+    if (dirty & DirtyStages::MultibandDirty)
+        updateMultiband(chainSettings);
+
+    if (dirty & (DirtyStages::LowCutDirty | DirtyStages::HighCutDirty | DirtyStages::ShaperDirty
+                 | DirtyStages::AntialiasingDirty | DirtyStages::MultibandDirty))
+        silenceGate.setHoldSamples(getSilenceHoldSamples(chainSettings));
+}
+
+void TestDistortionAudioProcessor::applyPreset(const PreparedPreset& preset) noexcept
+{
+    // Anything held back during the fade goes in first, so the preset has
+    // the last word.
+    updateDirtyStages();
+
+    updateHighCut(preset.settings);
+    updateLowCut(preset.settings);
+    updateGain(preset.settings);
+    updateWaveShaper(preset.settings);
+    updateAntialiasing(preset.settings);
+    updateMultiband(preset.settings);
+    silenceGate.setHoldSamples(getSilenceHoldSamples(preset.settings));
+
+    // The output is silent here, so the filters can start from nothing and
+    // the gains jump straight to the new values.
+    forEachChain([](auto& chain) { chain.reset(); });
+    vectorChain.reset();
+}
+
+void TestDistortionAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    juce::ignoreUnused(newValue);
+
+    for (const auto& entry : parameterStages)
+    {
+        if (parameterID == entry.parameterID)
+        {
+            parameterSnapshot.markChanged(entry.stage);
+            wakeEditor();
+
+            // Both can change the latency.
+            if (entry.stage & (DirtyStages::AntialiasingDirty | DirtyStages::MultibandDirty))
+                triggerAsyncUpdate();
+            return;
+        }
+    }
+}
+
+void TestDistortionAudioProcessor::handleAsyncUpdate()
+{
+    if (auto* preset = presetToSync.exchange(nullptr))
+    {
+        apvts.replaceState(preset->state.createCopy());
+        updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withProgramChanged(true));
+    }
+
+    std::optional<juce::String> curveSource;
+    {
+        const juce::ScopedLock lock(curveSourceLock);
+        curveSource.swap(curveToRestore);
+    }
+
+    if (curveSource.has_value())
+        restoreCustomCurve(*curveSource);
+
+    setLatencySamples(getShaperLatency(parameterSnapshot.read()));
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout TestDistortionAudioProcessor::createParameterLayout()
@@ -310,13 +827,47 @@ juce::AudioProcessorValueTreeState::ParameterLayout TestDistortionAudioProcessor
     stringArray.add("Pow5");
     stringArray.add("Pow7");
     stringArray.add("Hard");
+    stringArray.add("Custom");
 
     layout.add(std::make_unique<juce::AudioParameterChoice>("Distortion Type", "Distortion Type", stringArray, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Curve Accuracy", "Curve Accuracy", juce::StringArray{ "Draft", "Standard", "Exact" }, 1));
 
     layout.add(std::make_unique<juce::AudioParameterBool>("LowCut Bypassed", "LowCut Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>("HighCut Bypassed", "HighCut Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>("Distortion Bypassed", "Distortion Bypassed", false));
 
+    juce::StringArray oversamplingArray;
+    for (int order = 0; order <= OversampledWaveShaper<float>::maxOversamplingOrder; ++order)
+        oversamplingArray.add(juce::String(1 << order) + "x");
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling", "Oversampling", oversamplingArray, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling Filter", "Oversampling Filter", juce::StringArray{ "Polyphase IIR", "Linear Phase FIR" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Antialiasing", "Antialiasing", juce::StringArray{ "Off", "ADAA 1st Order", "ADAA 2nd Order" }, 0));
+
+    juce::StringArray slopeArray;
+    for (int slope = FilterSlopes::Slope6; slope <= FilterSlopes::Slope48; ++slope)
+        slopeArray.add(juce::String(6 * (slope + 1)) + " dB/Oct");
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>("LowCut Slope", "LowCut Slope", slopeArray, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("HighCut Slope", "HighCut Slope", slopeArray, 0));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Bands", "Bands", juce::StringArray{ "1", "2", "3", "4" }, 0));
+
+    const float crossoverDefaults[]{ 200.f, 1000.f, 5000.f };
+    for (size_t j = 0; j < MultibandParameterIDs::crossoverFreqs.size(); ++j)
+    {
+        auto* id = MultibandParameterIDs::crossoverFreqs[j];
+        layout.add(std::make_unique<juce::AudioParameterFloat>(id, id, juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), crossoverDefaults[j]));
+    }
+
+    for (size_t k = 0; k < MultibandParameterIDs::bandGains.size(); ++k)
+    {
+        auto* gainID = MultibandParameterIDs::bandGains[k];
+        auto* typeID = MultibandParameterIDs::bandTypes[k];
+        layout.add(std::make_unique<juce::AudioParameterFloat>(gainID, gainID, juce::NormalisableRange<float>(-25.0f, 25.0f, 0.5f, 1.f), 0.0f));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(typeID, typeID, stringArray, 0));
+    }
+
     return layout;
 }
 
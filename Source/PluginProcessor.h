@@ -12,54 +12,22 @@
 #include <numbers>
 #include <cmath>
 #include <array>
-
-template<typename T>
-struct Fifo
-{
-    void prepare(int numChannels, int numSamples)
-    {
-        for (auto& buffer : buffers)
-        {
-            buffer.setSize(numChannels,
-                numSamples,
-                false,
-                true,
-                true);
-            buffer.clear();
-        }
-    }
-
-    bool push(const T& t)
-    {
-        auto write = fifo.write(1);
-        if (write.blockSize1 > 0)
-        {
-            buffers[write.startIndex1] = t;
-            return true;
-        }
-        return false;
-    }
-
-    bool pull(T& t)
-    {
-        auto read = fifo.read(1);
-        if (read.blockSize1 > 0)
-        {
-            t = buffers[read.startIndex1];
-            return true;
-        }
-        return false;
-    }
-
-    int getNumAvailableForReading() const
-    {
-        return fifo.getNumReady();
-    }
-private:
-    static constexpr int Capacity = 30;
-    std::array<T, Capacity> buffers;
-    juce::AbstractFifo fifo { Capacity };
-};
+#include <vector>
+#include <algorithm>
+#include <optional>
+#include "WaveShapers.h"
+#include "OversampledWaveShaper.h"
+#include "VectorChain.h"
+#include "RealtimeWorkerPool.h"
+#include "ParameterSnapshot.h"
+#include "TptFilter.h"
+#include "SampleRing.h"
+#include "LevelMeter.h"
+#include "SilenceGate.h"
+#include "PresetBank.h"
+#include "CustomCurve.h"
+#include "ChainProfiler.h"
+#include "AllocationTracker.h"
 
 enum Channel
 {
@@ -75,127 +43,137 @@ struct SingleChannelSampleFifo
         prepared.set(false);
     }
 
-    void update(const BlockType& buffer)
+    void update(const BlockType& buffer, int numSamples)
     {
         jassert(prepared.get());
-        jassert(buffer.getNumChannels() > channelToUse);
-        auto* channelPtr = buffer.getReadPointer(channelToUse);
+        jassert(buffer.getNumChannels() > 0);
+        jassert(numSamples <= buffer.getNumSamples());
 
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
-        {
-            pushNextSampleIntoFifo(channelPtr[i]);
-        }
+        // A mono bus feeds both the left and the right fifo.
+        auto* channelPtr = buffer.getReadPointer(juce::jmin(static_cast<int>(channelToUse), buffer.getNumChannels() - 1));
+        ring.write(channelPtr, numSamples);
     }
 
     void prepare(int bufferSize)
     {
         prepared.set(false);
-        size.set(bufferSize);
-
-        bufferToFill.setSize(1,
-            bufferSize,
-            false,
-            true,
-            true);
-        audioBufferFifo.prepare(1, bufferSize);
-        fifoIndex = 0;
+        ring.prepare(bufferSize * numBlocksBuffered);
         prepared.set(true);
     }
 
-    int getNumCompleteBuffersAvailable() const { return audioBufferFifo.getNumAvailableForReading(); }
     bool isPrepared() const { return prepared.get(); }
-    int getSize() const { return size.get(); }
-    bool getAudioBuffer(BlockType& buf) { return audioBufferFifo.pull(buf); }
+
+    // For the editor, which is the ring's only reader.
+    SampleRing& getRing() noexcept { return ring; }
 private:
+    // Enough for the editor to miss a few frames at any block size.
+    static constexpr int numBlocksBuffered = 30;
+
     Channel channelToUse;
-    int fifoIndex = 0;
-    Fifo<BlockType> audioBufferFifo;
-    BlockType bufferToFill;
+    SampleRing ring;
     juce::Atomic<bool> prepared = false;
-    juce::Atomic<int> size = 0;
-
-    void pushNextSampleIntoFifo(float sample)
-    {
-        if (fifoIndex == bufferToFill.getNumSamples())
-        {
-            auto ok = audioBufferFifo.push(bufferToFill);
-            juce::ignoreUnused(ok);
-            fifoIndex = 0;
-        }
-
-        bufferToFill.setSample(0, fifoIndex, sample);
-        ++fifoIndex;
-    }
-};
-
-enum DistTypes
-{
-    ArcTan,
-    HypTan,
-    Cubic,
-    Pow5,
-    Pow7,
-    Hard
-};
-
-struct ChainSettings
-{
-    float lowFreq{ 0 };
-    float highFreq{ 0 };
-    float inGain{ 0 };
-    float outGain{ 0 };
-    DistTypes distType { DistTypes::ArcTan };
-
-    bool lowCutBypassed{ false }, highCutBypassed{ false }, distortionBypassed{ false };
 };
 
+// Copies the signal for the editor's fifos, which are float whatever the
+// chain runs in.
+template<typename SampleType>
 struct FifoBlock
 {
-    FifoBlock()
+    void prepare(const juce::dsp::ProcessSpec& spec)
     {
-        fifoBuffer.setSize(1, 441);
+        fifoBuffer.setSize(1, static_cast<int>(spec.maximumBlockSize), false, true, false);
+        numSamples = 0;
     }
-    void prepare(const juce::dsp::ProcessSpec& spec) noexcept {}
-    juce::AudioBuffer<float> getBuffer()
+    void reset() noexcept {}
+    const juce::AudioBuffer<float>& getBuffer() const noexcept
     {
         return fifoBuffer;
     }
-    int getNumSamples()
+    int getNumSamples() const noexcept
     {
-        return fifoBuffer.getNumSamples();
+        return numSamples;
     }
-    void process(const juce::dsp::ProcessContextReplacing<float>& context)
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept
     {
-        const juce::dsp::AudioBlock<const float> tempBlock = context.getOutputBlock();
-        fifoBuffer.setSize(1, tempBlock.getNumSamples(), false, false, true);
-        fifoBuffer.copyFrom(0, 0, tempBlock.getChannelPointer(0), tempBlock.getNumSamples());
+        if (context.isBypassed)
+            return;
+
+        const juce::dsp::AudioBlock<const SampleType> tempBlock = context.getOutputBlock();
+        jassert(tempBlock.getNumSamples() <= static_cast<size_t>(fifoBuffer.getNumSamples()));
+        numSamples = juce::jmin(static_cast<int>(tempBlock.getNumSamples()), fifoBuffer.getNumSamples());
+
+        auto* source = tempBlock.getChannelPointer(0);
+        std::copy(source, source + numSamples, fifoBuffer.getWritePointer(0));
     }
 private:
     juce::AudioBuffer<float> fifoBuffer;
+    int numSamples = 0;
 };
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+template<typename SampleType>
+struct MeterBlock
+{
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        meter.prepare(spec.sampleRate, static_cast<int>(spec.maximumBlockSize));
+    }
+    void reset() noexcept { meter.reset(); }
+    MeterLevels getLevels() const noexcept
+    {
+        return meter.getLevels(0);
+    }
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept
+    {
+        if (context.isBypassed)
+            return;
+
+        const juce::dsp::AudioBlock<const SampleType> tempBlock = context.getOutputBlock();
+        meter.process(tempBlock.getChannelPointer(0), tempBlock.getNumSamples());
+    }
+private:
+    LevelMeter<SampleType> meter;
+};
 
-using Filter = juce::dsp::IIR::Filter<float>;
-using Waveshaper = juce::dsp::WaveShaper<float>;
-using Gain = juce::dsp::Gain<float>;
-using CutFilter = juce::dsp::ProcessorChain<Filter>;
-using MonoChain = juce::dsp::ProcessorChain<CutFilter, Gain, FifoBlock, Waveshaper, Gain, CutFilter>;
+template<typename SampleType>
+using Waveshaper = OversampledWaveShaper<SampleType>;
+template<typename SampleType>
+using Gain = juce::dsp::Gain<SampleType>;
+template<typename SampleType>
+using LowCutFilter = TptCutFilter<CutFilterTypes::HighPassCut, SampleType>;
+template<typename SampleType>
+using HighCutFilter = TptCutFilter<CutFilterTypes::LowPassCut, SampleType>;
+
+// One channel of the reference path, in float or double. Profiled is the
+// stage itself unless profiling is compiled in.
+template<typename SampleType>
+using MonoChain = juce::dsp::ProcessorChain<Profiled<LowCutFilter<SampleType>>, Profiled<Gain<SampleType>>, Profiled<FifoBlock<SampleType>>,
+                                            Profiled<MeterBlock<SampleType>>, Profiled<Waveshaper<SampleType>>, Profiled<MeterBlock<SampleType>>,
+                                            Profiled<Gain<SampleType>>, Profiled<HighCutFilter<SampleType>>>;
+
+// Stages of the chain that need redesigning after a parameter change.
+enum DirtyStages
+{
+    LowCutDirty = 1 << 0,
+    HighCutDirty = 1 << 1,
+    GainDirty = 1 << 2,
+    ShaperDirty = 1 << 3,
+    AntialiasingDirty = 1 << 4,
+    MultibandDirty = 1 << 5,
+    AllDirty = LowCutDirty | HighCutDirty | GainDirty | ShaperDirty | AntialiasingDirty | MultibandDirty
+};
 
-enum ChainPositions
+enum ProcessingPaths
 {
-    LowCut,
-    GainIn,
-    FifoBlk,
-    WaveShape,
-    GainOut,
-    HighCut
+    ReferencePath,
+    VectorPath
 };
 
 //==============================================================================
 /**
 */
-class TestDistortionAudioProcessor  : public juce::AudioProcessor
+class TestDistortionAudioProcessor  : public juce::AudioProcessor,
+                                      private juce::AudioProcessorValueTreeState::Listener,
+                                      private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -206,11 +184,17 @@ public:
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
 
+    // Hosts report the workgroup around (re)activation; the workers join it
+    // when prepareToPlay next starts them.
+    void audioWorkgroupContextChanged (const juce::AudioWorkgroup& workgroup) override;
+
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -242,84 +226,170 @@ public:
     SingleChannelSampleFifo<BlockType> leftChannelFifo{ Channel::Left };
     SingleChannelSampleFifo<BlockType> rightChannelFifo{ Channel::Right };
 
+    // VectorPath runs all channels through one VectorChain; ReferencePath
+    // runs one MonoChain per channel and is kept for output comparison.
+    // On buses wider than stereo both paths spread their work across
+    // workerPool. VectorChain is float only, so double-precision buffers
+    // always take the reference path, in double.
+    void setProcessingPath(ProcessingPaths newPath) noexcept { processingPath.store(newPath); }
+    ProcessingPaths getProcessingPath() const noexcept { return processingPath.load(); }
+
+    const ParameterSnapshot& getParameterSnapshot() const noexcept { return parameterSnapshot; }
+
+    // Sub-blocks whose input is silent are skipped once the tail has died
+    // away. The gate counts how many samples were slept through.
+    const SilenceGate& getSilenceGate() const noexcept { return silenceGate; }
+
+    // The programs the host sees. setCurrentProgram() is a pointer swap for
+    // the audio thread, with the parameters following on the message thread.
+    PresetBank& getPresetBank() noexcept { return presetBank; }
+
+    // Parses and tabulates a curve for the Custom distortion type on the
+    // calling thread, which must be the message thread, and swaps it in at
+    // the start of the next block. The curve is saved with the state.
+    juce::Result loadCustomCurve(const juce::File& file);
+    juce::Result loadCustomCurve(const juce::String& text);
+    const CustomCurveSlot& getCustomCurves() const noexcept { return customCurves; }
+
+    // processBlock works through host buffers in sub-blocks of at most this
+    // many samples, so the chains' working set stays in cache however large
+    // the host's blocks are. Takes effect at the next prepareToPlay.
+    static constexpr int defaultSubBlockSize = 128;
+    void setSubBlockSize(int newSize) noexcept { subBlockSize.store(juce::jlimit(16, 4096, newSize)); }
+    int getSubBlockSize() const noexcept { return subBlockSize.load(); }
+
+    // The editor picks what processBlock gathers for it. The fifos are only
+    // fed in MetersAndSamples mode, which the editor's scope asks for while
+    // it is shown, and nothing is metered with no editor.
+    void setVisualisationMode(VisualisationModes newMode) noexcept { visualisationMode.store(newMode); }
+    MeterLevels getMeterLevels(MeterPoints point) const noexcept { return meters[static_cast<size_t>(point)].load(); }
+
+    // An editor that has stopped polling calls sleepUntilActivity(). The
+    // next parameter change, curve or change in the meters then sends one
+    // change message from getActivityBroadcaster() to wake it up.
+    void sleepUntilActivity() noexcept;
+    juce::ChangeBroadcaster& getActivityBroadcaster() noexcept { return activityBroadcaster; }
+
+    // Stage and processBlock timings; empty unless TESTDISTORTION_PROFILING
+    // is set.
+    ChainProfiler& getProfiler() noexcept { return profiler; }
+
+   #if TESTDISTORTION_TRACK_ALLOCATIONS
+    // Makes the next processBlock build a scratch AudioBuffer, the mistake
+    // the allocation guard is there to catch, so tools can check it fires.
+    void allocateInNextBlock() noexcept { allocationProbe.store(true); }
+   #endif
+
 private:
-    MonoChain leftChain, rightChain;
+    // One chain per channel of the main bus, sized in prepareToPlay. Only
+    // the set matching the processing precision is filled.
+    std::vector<MonoChain<float>> chains;
+    std::vector<MonoChain<double>> doubleChains;
+    VectorChain vectorChain;
+    RealtimeWorkerPool workerPool;
+    juce::AudioWorkgroup audioWorkgroup;
+    std::atomic<ProcessingPaths> processingPath{ ProcessingPaths::VectorPath };
+
+    std::atomic<int> subBlockSize{ defaultSubBlockSize };
+    int preparedSubBlockSize = defaultSubBlockSize;
+
+    // Samples processed since prepareToPlay. Sub-blocks start at multiples
+    // of preparedSubBlockSize in this count, so where they fall doesn't
+    // depend on how the host splits its buffers.
+    juce::uint64 samplePosition = 0;
+
+    SilenceGate silenceGate;
+
+    PresetBank presetBank{ apvts };
+    PresetSwitch presetSwitch;
+    std::atomic<int> currentProgram{ 0 };
+
+    // The preset whose state the parameters still have to catch up with.
+    std::atomic<const PreparedPreset*> presetToSync{ nullptr };
+
+    // The state methods may run on any thread, but customCurves belongs to
+    // the message thread. They go through these instead: the source of the
+    // published curve, and a restored one still waiting to be loaded.
+    juce::CriticalSection curveSourceLock;
+    juce::String publishedCurveSource;
+    std::optional<juce::String> curveToRestore;
+
+    CustomCurveSlot customCurves;
+    const CustomCurveTable* appliedCustomCurve = nullptr;
+
+    // Published from parameter listeners on any thread, read by
+    // processBlock and the editor.
+    ParameterSnapshot parameterSnapshot{ apvts };
+
+    // Pre-shaper signal of the reference path, gathered for the fifos.
+    juce::AudioBuffer<float> fifoBuffer;
 
-    using Coefficients = Filter::CoefficientsPtr;
-    static void updateCoefficients(Coefficients& old, const Coefficients& replacements);
+    std::atomic<VisualisationModes> visualisationMode{ VisualisationModes::NoVisualisation };
+    std::array<PublishedMeter, 2> meters;
 
-    template<typename ChainType>
-    void updateWaveShape(ChainType& waveshape, const DistTypes& distType)
-    {
-        switch (distType)
-        {
-        case ArcTan:
-        {
-            waveshape.functionToUse = [](float x) {
-                return atan(x * std::numbers::pi_v<float> / 2) * 2 / std::numbers::pi_v<float>;
-                };
-            break;
-        }
-        case HypTan:
-        {
-            waveshape.functionToUse = [](float x) {
-                return std::tanh(x);
-                };
-            break;
-        }
-        case Cubic:
-        {
-            waveshape.functionToUse = [](float x) {
-                float temp;
-                if (x >= 1) temp = 2.f / 3;
-                else if (x <= -1) temp = -2.f / 3;
-                else temp = x - (std::pow(x, 3) / 3);
-                return temp;
-                };
-            break;
-        }
-        case Pow5:
-        {
-            waveshape.functionToUse = [](float x) {
-                float temp;
-                if (x >= 1) temp = 11.f / 15;
-                else if (x <= -1) temp = -11.f / 15;
-                else temp = x - (std::pow(x, 3) / 6) - (std::pow(x, 5) / 10);
-                return temp;
-                };
-
-            break;
-        }
-        case Pow7:
-        {
-            waveshape.functionToUse = [](float x) {
-                float temp;
-                if (x >= 1) temp = 19.f / 24;
-                else if (x <= -1) temp = -19.f / 24;
-                else temp = x - (std::pow(x, 3) / 12) - (std::pow(x, 5) / 16) - (std::pow(x, 7) / 16);
-                return temp;
-                };
-            break;
-        }
-        case Hard:
-        {
-            waveshape.functionToUse = [](float x) {
-                float temp = x;
-                if (temp >= 1) temp = 1.f;
-                else if (temp <= -1) temp = -1.f;
-                return (temp);
-                };
-            break;
-        }
-        }
-    }
+    std::atomic<bool> editorAsleep{ false };
+    juce::ChangeBroadcaster activityBroadcaster;
+
+    // Stage names in ChainPositions order.
+    ChainProfiler profiler{ { "LowCut", "GainIn", "FifoBlk", "PreMeter", "WaveShape", "PostMeter", "GainOut", "HighCut" } };
+
+   #if TESTDISTORTION_TRACK_ALLOCATIONS
+    std::atomic<bool> allocationProbe{ false };
+   #endif
 
     void updateHighCut(const ChainSettings& chainSettings);
     void updateLowCut(const ChainSettings& chainSettings);
     void updateGain(const ChainSettings& chainSettings);
     void updateWaveShaper(const ChainSettings& chainSettings);
+    void updateAntialiasing(const ChainSettings& chainSettings);
+    void updateMultiband(const ChainSettings& chainSettings);
+    int getShaperLatency(const ChainSettings& chainSettings) const;
+    double getFilterTailSeconds(const ChainSettings& chainSettings) const;
+    int getSilenceHoldSamples(const ChainSettings& chainSettings) const;
+
+    void updateDirtyStages();
+    void applyPreset(const PreparedPreset& preset) noexcept;
+
+    template<typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer);
+
+    // One sub-block, on the path for its precision.
+    void processSubBlock(juce::dsp::AudioBlock<float> block, bool usesVectorChain, bool capturingSamples) noexcept;
+    void processSubBlock(juce::dsp::AudioBlock<double> block, bool usesVectorChain, bool capturingSamples) noexcept;
+
+    template<typename SampleType>
+    void processReferencePath(juce::dsp::AudioBlock<SampleType> block, std::vector<MonoChain<SampleType>>& channelChains,
+                              bool capturingSamples) noexcept;
+
+    template<typename SampleType>
+    std::vector<MonoChain<SampleType>>& getChains() noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doubleChains;
+        else
+            return chains;
+    }
+
+    template<typename Function>
+    void forEachChain(Function&& function)
+    {
+        for (auto& chain : chains)
+            function(chain);
+        for (auto& chain : doubleChains)
+            function(chain);
+    }
+
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+
+    // Any thread. Posts at most one message per sleepUntilActivity().
+    void wakeEditor() noexcept;
+    void publishMeters(const MeterLevels& preShaper, const MeterLevels& postShaper) noexcept;
 
-    void updateChain();
+    // Reports the shaper latency to the host from the message thread, and
+    // catches up with presets and restored curves.
+    void handleAsyncUpdate() override;
+    void restoreCustomCurve(const juce::String& curveSource);
+    void publishCustomCurve(std::unique_ptr<CustomCurveTable> table);
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TestDistortionAudioProcessor)
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+#include <initializer_list>
+
+namespace
+{
+    struct FactoryValue
+    {
+        const char* parameterID;
+        float value;
+    };
+
+    struct FactoryPreset
+    {
+        const char* name;
+        std::initializer_list<FactoryValue> values;
+    };
+
+    // Values as the state stores them: plain units, and indices for choices.
+    const FactoryPreset factoryPresets[]
+    {
+        { "Init", {} },
+        { "Warm Tape", { { "Distortion Type", 0.f }, { "Input Gain", 6.f }, { "Output Gain", -4.f },
+                         { "LowCut Freq", 30.f }, { "LowCut Slope", 1.f },
+                         { "HighCut Freq", 12000.f }, { "HighCut Slope", 1.f } } },
+        { "Soft Cubic", { { "Distortion Type", 2.f }, { "Input Gain", 3.f }, { "Output Gain", -1.5f },
+                          { "HighCut Bypassed", 1.f } } },
+        { "Crunch", { { "Distortion Type", 1.f }, { "Input Gain", 12.f }, { "Output Gain", -8.f },
+                      { "LowCut Freq", 80.f }, { "LowCut Slope", 1.f },
+                      { "HighCut Freq", 8000.f }, { "HighCut Slope", 3.f },
+                      { "Oversampling", 1.f } } },
+        { "Fuzz", { { "Distortion Type", 5.f }, { "Input Gain", 20.f }, { "Output Gain", -14.f },
+                    { "LowCut Freq", 120.f }, { "LowCut Slope", 3.f },
+                    { "HighCut Freq", 6000.f }, { "HighCut Slope", 3.f },
+                    { "Oversampling", 2.f }, { "Antialiasing", 1.f } } }
+    };
+}
+
+PresetBank::PresetBank(juce::AudioProcessorValueTreeState& apvts) :
+    parameters(apvts)
+{
+    for (const auto& factoryPreset : factoryPresets)
+    {
+        // Start from the defaults, which is what the state holds before
+        // anything has been loaded into it.
+        auto state = apvts.copyState();
+
+        for (const auto& entry : factoryPreset.values)
+        {
+            auto parameter = state.getChildWithProperty("id", entry.parameterID);
+            if (! parameter.isValid())
+            {
+                parameter = juce::ValueTree("PARAM");
+                parameter.setProperty("id", entry.parameterID, nullptr);
+                state.appendChild(parameter, nullptr);
+            }
+
+            parameter.setProperty("value", entry.value, nullptr);
+        }
+
+        addPreset(factoryPreset.name, state);
+    }
+}
+
+const PreparedPreset* PresetBank::getPreset(int index) const noexcept
+{
+    if (! juce::isPositiveAndBelow(index, getNumPresets()))
+        return nullptr;
+
+    return presets[static_cast<size_t>(index)].get();
+}
+
+void PresetBank::setName(int index, const juce::String& newName)
+{
+    if (juce::isPositiveAndBelow(index, getNumPresets()))
+        presets[static_cast<size_t>(index)]->name = newName;
+}
+
+int PresetBank::addPreset(const juce::String& name, const juce::ValueTree& state)
+{
+    auto preset = std::make_unique<PreparedPreset>();
+    preset->name = name;
+    preset->state = state.createCopy();
+    preset->settings = parameters.loadFromState(preset->state);
+
+    presets.push_back(std::move(preset));
+    return getNumPresets() - 1;
+}
+
+//==============================================================================
+void PresetSwitch::prepare(double sampleRate) noexcept
+{
+    fade.reset(sampleRate, fadeSeconds);
+    fade.setCurrentAndTargetValue(1.f);
+    fadingOut = false;
+}
+
+const PreparedPreset* PresetSwitch::takePending() noexcept
+{
+    fadingOut = false;
+    fade.setCurrentAndTargetValue(1.f);
+    return pending.exchange(nullptr, std::memory_order_acq_rel);
+}
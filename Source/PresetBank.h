@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+
+    The plugin's programs, resolved to ChainSettings ahead of time so the
+    audio thread can switch between them without touching a ValueTree.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "ParameterSnapshot.h"
+
+// One program, read-only once the bank has made it.
+struct PreparedPreset
+{
+    juce::String name;
+
+    // For the host and the editor, in the form getStateInformation saves.
+    juce::ValueTree state;
+
+    // What the audio thread applies.
+    ChainSettings settings;
+};
+
+//==============================================================================
+/**
+    Owns the programs. Everything here runs on the message thread.
+
+    Presets are only ever added, and each lives at a fixed address until
+    the bank goes, so the audio thread can hold on to a PreparedPreset
+    pointer for as long as it likes.
+*/
+class PresetBank
+{
+public:
+    // Starts out with the factory presets.
+    explicit PresetBank(juce::AudioProcessorValueTreeState& apvts);
+
+    int getNumPresets() const noexcept { return static_cast<int>(presets.size()); }
+    const PreparedPreset* getPreset(int index) const noexcept;
+
+    // The name is never read by the audio thread, so it can change in place.
+    void setName(int index, const juce::String& newName);
+
+    // Returns the new preset's index.
+    int addPreset(const juce::String& name, const juce::ValueTree& state);
+
+private:
+    ChainParameters parameters;
+    std::vector<std::unique_ptr<PreparedPreset>> presets;
+};
+
+//==============================================================================
+/**
+    The audio thread's side of a program change. A request is a pointer
+    store. The audio thread fades out what it is playing, swaps the new
+    settings in while the output is silent, and fades back in, so slope,
+    curve and oversampling changes land without a click.
+*/
+struct PresetSwitch
+{
+    static constexpr double fadeSeconds = 0.01;
+
+    void prepare(double sampleRate) noexcept;
+
+    // Any thread. A request made mid-switch replaces the one pending.
+    void request(const PreparedPreset& preset) noexcept { pending.store(&preset, std::memory_order_release); }
+
+    // Audio thread only from here on. True until the old settings are out.
+    bool isSwitching() const noexcept { return fadingOut || pending.load(std::memory_order_acquire) != nullptr; }
+
+    // Fades a processed block. Returns the preset to apply before the next
+    // block once the fade-out is done, and nullptr otherwise.
+    template<typename SampleType>
+    const PreparedPreset* process(const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        if (! fadingOut && pending.load(std::memory_order_acquire) != nullptr)
+        {
+            fadingOut = true;
+            fade.setTargetValue(0.f);
+        }
+
+        if (! fade.isSmoothing() && fade.getTargetValue() == 1.f)
+            return nullptr;
+
+        for (size_t i = 0; i < block.getNumSamples(); ++i)
+        {
+            auto gain = static_cast<SampleType>(fade.getNextValue());
+            for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+                block.getChannelPointer(ch)[i] *= gain;
+        }
+
+        if (! fadingOut || fade.isSmoothing())
+            return nullptr;
+
+        fadingOut = false;
+        fade.setTargetValue(1.f);
+        return pending.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    // For when the output is silent anyway: no fade, just the preset.
+    const PreparedPreset* takePending() noexcept;
+
+private:
+    std::atomic<const PreparedPreset*> pending{ nullptr };
+    juce::SmoothedValue<float> fade{ 1.f };
+    bool fadingOut = false;
+};
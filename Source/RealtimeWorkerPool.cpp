@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+
+    RealtimeWorkerPool.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeWorkerPool.h"
+#include "AllocationTracker.h"
+#include <thread>
+
+namespace
+{
+    constexpr int countShift = 32, batchShift = 48;
+    constexpr juce::uint64 indexMask = 0xffffffff, countMask = 0xffff;
+}
+
+RealtimeWorkerPool::Worker::Worker(RealtimeWorkerPool& poolToUse, const juce::AudioWorkgroup& workgroupToJoin) :
+    juce::Thread("Realtime worker"),
+    pool(poolToUse),
+    workgroup(workgroupToJoin)
+{
+}
+
+void RealtimeWorkerPool::Worker::run()
+{
+    // On macOS this schedules the worker alongside the host's audio
+    // threads; elsewhere, or with no workgroup, it does nothing.
+    juce::WorkgroupToken token;
+    workgroup.join(token);
+
+    pool.workerLoop(*this);
+}
+
+RealtimeWorkerPool::~RealtimeWorkerPool()
+{
+    stop();
+}
+
+void RealtimeWorkerPool::start(int numWorkers, double sampleRate, int blockSize, const juce::AudioWorkgroup& workgroup)
+{
+    stop();
+
+    shouldExit.store(false);
+
+    for (int i = 0; i < numWorkers; ++i)
+        workers.push_back(std::make_unique<Worker>(*this, workgroup));
+
+    auto options = juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(juce::jmax(1, blockSize), sampleRate);
+
+    for (auto& worker : workers)
+        if (! worker->startRealtimeThread(options))
+            worker->startThread(juce::Thread::Priority::highest);
+}
+
+void RealtimeWorkerPool::stop()
+{
+    shouldExit.store(true);
+
+    for (auto& worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wake.release();
+    }
+
+    for (auto& worker : workers)
+        worker->waitForThreadToExit(-1);
+
+    workers.clear();
+}
+
+void RealtimeWorkerPool::runJobs(int numJobs, void* context, JobFunction function) noexcept
+{
+    jassert(unfinishedJobs.load() == 0);
+    jassert(static_cast<juce::uint64>(numJobs) <= countMask);
+
+    jobContext = context;
+    jobFunction = function;
+    unfinishedJobs.store(numJobs, std::memory_order_relaxed);
+
+    // Publishing the new batch releases the writes above to whichever
+    // thread claims one of its jobs.
+    auto batch = ((claims.load(std::memory_order_relaxed) >> batchShift) + 1) & countMask;
+    claims.store((batch << batchShift) | (static_cast<juce::uint64>(numJobs) << countShift), std::memory_order_release);
+
+    // The calling thread takes a share too, so one fewer worker is needed
+    // than there are jobs.
+    auto numToWake = juce::jmin(getNumWorkers(), numJobs - 1);
+    for (int i = 0; i < numToWake; ++i)
+        workers[static_cast<size_t>(i)]->wake.release();
+
+    // Whatever the workers haven't claimed by now, this thread runs itself.
+    claimJobs();
+
+    // What is left are jobs a worker is partway through. The workers run at
+    // the audio thread's priority, so that is normally a few microseconds;
+    // spin, then give way in case one was preempted all the same.
+    for (int spins = 0; unfinishedJobs.load(std::memory_order_acquire) != 0; ++spins)
+        if (spins > 1000)
+            std::this_thread::yield();
+}
+
+void RealtimeWorkerPool::claimJobs() noexcept
+{
+    auto word = claims.load(std::memory_order_acquire);
+
+    for (;;)
+    {
+        auto index = static_cast<int>(word & indexMask);
+        auto count = static_cast<int>((word >> countShift) & countMask);
+
+        if (index >= count)
+            return;
+
+        // Claiming through the whole word fails if the batch has moved on,
+        // so a job is only ever run with its own batch's function.
+        if (claims.compare_exchange_weak(word, word + 1, std::memory_order_acquire))
+        {
+            jobFunction(jobContext, index);
+            unfinishedJobs.fetch_sub(1, std::memory_order_release);
+            ++word;
+        }
+    }
+}
+
+void RealtimeWorkerPool::workerLoop(Worker& worker) noexcept
+{
+    for (;;)
+    {
+        worker.wake.acquire();
+
+        if (shouldExit.load())
+            return;
+
+        // Denormal flags are per thread, so the host's setting on the
+        // audio thread doesn't reach the workers.
+        juce::ScopedNoDenormals noDenormals;
+        AllocationTracker::ScopedRealtimeSection realtimeSection;
+        claimJobs();
+    }
+}
@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    RealtimeWorkerPool.h
+
+    Fork-join pool that lets processBlock spread independent channel jobs
+    across cores without allocating or taking locks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <semaphore>
+#include <vector>
+
+//==============================================================================
+/**
+    A fixed set of worker threads, started in prepareToPlay, that sleep on a
+    semaphore between blocks. They run with realtime priority where the OS
+    allows it (high priority otherwise), and join the host's audio workgroup
+    where there is one, so other work on the machine can't hold them up
+    while the audio thread waits.
+
+    run() publishes a job count and a function, wakes as many workers as can
+    be useful, then claims jobs itself alongside them. Jobs are claimed one
+    at a time from an atomic counter, so a slow channel doesn't hold up the
+    others, and a worker that is late to wake finds the jobs already done
+    rather than holding run() up. run() only waits for jobs a worker has
+    started, which takes no longer than running the job would.
+
+    With no workers, or a single job, run() just calls the jobs in order on
+    the calling thread.
+*/
+struct RealtimeWorkerPool
+{
+    RealtimeWorkerPool() = default;
+    ~RealtimeWorkerPool();
+
+    // Replaces the current workers. Starts and joins threads, so only call
+    // this from prepareToPlay or releaseResources. The block size and rate
+    // tell the OS how much work each wake-up brings.
+    void start(int numWorkers, double sampleRate, int blockSize, const juce::AudioWorkgroup& workgroup);
+    void stop();
+
+    int getNumWorkers() const noexcept { return static_cast<int>(workers.size()); }
+
+    // Calls job(index) for every index in [0, numJobs), across the workers
+    // and the calling thread, and returns once all of them have finished.
+    template<typename Job>
+    void run(int numJobs, Job& job) noexcept
+    {
+        if (workers.empty() || numJobs <= 1)
+        {
+            for (int i = 0; i < numJobs; ++i)
+                job(i);
+            return;
+        }
+
+        runJobs(numJobs, &job, [](void* context, int index) { (*static_cast<Job*>(context))(index); });
+    }
+
+private:
+    using JobFunction = void (*)(void*, int);
+
+    struct Worker : juce::Thread
+    {
+        Worker(RealtimeWorkerPool& poolToUse, const juce::AudioWorkgroup& workgroupToJoin);
+        void run() override;
+
+        RealtimeWorkerPool& pool;
+        juce::AudioWorkgroup workgroup;
+        std::counting_semaphore<> wake{ 0 };
+    };
+
+    void runJobs(int numJobs, void* context, JobFunction function) noexcept;
+    void claimJobs() noexcept;
+    void workerLoop(Worker& worker) noexcept;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // Written by run() before the batch is published, read-only until all
+    // of its jobs have finished.
+    void* jobContext = nullptr;
+    JobFunction jobFunction = nullptr;
+
+    // Batch number, job count and next job index in one word, so a worker
+    // can only claim a job of the batch it read the count of. A worker
+    // woken for an earlier batch finds nothing left and goes back to sleep.
+    std::atomic<juce::uint64> claims{ 0 };
+    std::atomic<int> unfinishedJobs{ 0 };
+    std::atomic<bool> shouldExit{ false };
+
+    JUCE_DECLARE_NON_COPYABLE(RealtimeWorkerPool)
+};
@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    SampleRing.cpp
+
+  ==============================================================================
+*/
+
+#include "SampleRing.h"
+#include <cstring>
+#include <thread>
+
+void SampleRing::prepare(int minimumCapacity)
+{
+    // The reader is only ever busy for one drain, so this is a short wait.
+    resetting.store(true);
+    while (readerBusy.load())
+        std::this_thread::yield();
+
+    capacity = static_cast<std::uint64_t>(juce::nextPowerOfTwo(juce::jmax(1, minimumCapacity)));
+    mask = capacity - 1;
+    buffer.allocate(static_cast<size_t>(capacity), true);
+
+    writePosition.store(0);
+    readPosition.store(0);
+
+    resetting.store(false);
+}
+
+void SampleRing::write(const float* samples, int numSamples) noexcept
+{
+    // Acquire pairs with attachReader(), so a newly attached reader's
+    // position is seen along with the flag.
+    if (! readerAttached.load(std::memory_order_acquire) || numSamples <= 0 || capacity == 0)
+        return;
+
+    auto write = writePosition.load(std::memory_order_relaxed);
+    auto read = readPosition.load(std::memory_order_acquire);
+
+    // Never more than the ring holds, even if the positions disagree.
+    auto space = capacity - (write - read);
+    auto toWrite = juce::jmin(static_cast<std::uint64_t>(numSamples), space, capacity);
+
+    if (toWrite < static_cast<std::uint64_t>(numSamples))
+    {
+        // Only this thread writes the counters, so there is no need for a
+        // read-modify-write.
+        overflows.store(overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        droppedSamples.store(droppedSamples.load(std::memory_order_relaxed) + (numSamples - toWrite), std::memory_order_relaxed);
+    }
+
+    auto start = write & mask;
+    auto firstSize = juce::jmin(toWrite, capacity - start);
+
+    std::memcpy(buffer.get() + start, samples, static_cast<size_t>(firstSize) * sizeof(float));
+    std::memcpy(buffer.get(), samples + firstSize, static_cast<size_t>(toWrite - firstSize) * sizeof(float));
+
+    writePosition.store(write + toWrite, std::memory_order_release);
+}
+
+bool SampleRing::enterReader() noexcept
+{
+    readerBusy.store(true);
+    if (! resetting.load())
+        return true;
+
+    readerBusy.store(false);
+    return false;
+}
+
+void SampleRing::attachReader() noexcept
+{
+    while (! enterReader())
+        std::this_thread::yield();
+
+    readPosition.store(writePosition.load(std::memory_order_acquire), std::memory_order_release);
+    readerAttached.store(true, std::memory_order_release);
+    readerBusy.store(false);
+}
+
+void SampleRing::detachReader() noexcept
+{
+    readerAttached.store(false, std::memory_order_release);
+}
+
+SampleRing::Spans SampleRing::getReadableSpans() noexcept
+{
+    Spans spans;
+    if (! enterReader())
+        return spans;
+
+    auto write = writePosition.load(std::memory_order_acquire);
+    auto read = readPosition.load(std::memory_order_relaxed);
+
+    auto available = juce::jmin(write - read, capacity);
+    auto start = read & mask;
+    auto firstSize = juce::jmin(available, capacity - start);
+
+    spans.first = buffer.get() + start;
+    spans.firstSize = static_cast<int>(firstSize);
+    spans.second = buffer.get();
+    spans.secondSize = static_cast<int>(available - firstSize);
+    return spans;
+}
+
+void SampleRing::finishedReading(int numSamples) noexcept
+{
+    // getReadableSpans() found prepare() under way, and handed out nothing.
+    if (! readerBusy.load(std::memory_order_relaxed))
+        return;
+
+    auto read = readPosition.load(std::memory_order_relaxed);
+    auto available = juce::jmin(writePosition.load(std::memory_order_acquire) - read, capacity);
+
+    jassert(static_cast<std::uint64_t>(numSamples) <= available);
+    auto toRelease = juce::jmin(static_cast<std::uint64_t>(juce::jmax(0, numSamples)), available);
+
+    readPosition.store(read + toRelease, std::memory_order_release);
+    readerBusy.store(false);
+}
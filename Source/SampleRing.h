@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    SampleRing.h
+
+    Wait-free single-producer/single-consumer ring of samples, for getting
+    audio from processBlock to the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+
+//==============================================================================
+/**
+    The audio thread writes whole spans with write(), and the reader gets
+    the unread samples back as (at most) two spans that point straight into
+    the ring. Neither side ever waits for the other.
+
+    Writes only happen while a reader is attached. When the ring is full,
+    write() drops the samples that don't fit and counts the overflow, so a
+    reader that falls behind shows up in getNumOverflows() rather than
+    going unnoticed.
+
+    prepare() may run while the reader is polling. The reader marks itself
+    busy from getReadableSpans() to finishedReading(), and prepare() waits
+    for it to finish before it swaps the storage and resets the positions;
+    meanwhile the reader sees nothing to read. So the reader must hand its
+    spans back within the same callback.
+*/
+struct SampleRing
+{
+    struct Spans
+    {
+        const float* first = nullptr;
+        int firstSize = 0;
+        const float* second = nullptr;
+        int secondSize = 0;
+
+        int getTotalSize() const noexcept { return firstSize + secondSize; }
+    };
+
+    // Rounds the capacity up to a power of two. Not with the writer, but the
+    // reader may be running; see above.
+    void prepare(int minimumCapacity);
+
+    // Audio thread only.
+    void write(const float* samples, int numSamples) noexcept;
+
+    // Reader only. Attaching skips anything left over from before.
+    void attachReader() noexcept;
+    void detachReader() noexcept;
+
+    // The unread samples, oldest first. They stay valid, and unchanged,
+    // until finishedReading() hands them back to the writer, which must
+    // follow every call.
+    Spans getReadableSpans() noexcept;
+    void finishedReading(int numSamples) noexcept;
+
+    int getCapacity() const noexcept { return static_cast<int>(capacity); }
+    juce::uint32 getNumOverflows() const noexcept { return overflows.load(std::memory_order_relaxed); }
+    juce::uint64 getNumDroppedSamples() const noexcept { return droppedSamples.load(std::memory_order_relaxed); }
+
+private:
+    juce::HeapBlock<float> buffer;
+    std::uint64_t capacity = 0, mask = 0;
+
+    // Free-running sample counts; their difference is the fill level.
+    // Kept on separate cache lines so the two sides don't contend.
+    alignas(64) std::atomic<std::uint64_t> writePosition{ 0 };
+    alignas(64) std::atomic<std::uint64_t> readPosition{ 0 };
+
+    // Sequentially consistent, so the reader and prepare() can't both miss
+    // each other's flag.
+    bool enterReader() noexcept;
+    std::atomic<bool> readerBusy{ false }, resetting{ false };
+
+    std::atomic<bool> readerAttached{ false };
+    std::atomic<juce::uint32> overflows{ 0 };
+    std::atomic<juce::uint64> droppedSamples{ 0 };
+};
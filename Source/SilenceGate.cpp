@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    SilenceGate.cpp
+
+  ==============================================================================
+*/
+
+#include "SilenceGate.h"
+
+void SilenceGate::prepare(int newHoldSamples) noexcept
+{
+    setHoldSamples(newHoldSamples);
+    silentSamples = 0;
+    asleep = wokeUp = false;
+
+    samplesAsleep.store(0);
+    samplesSeen.store(0);
+}
+
+bool SilenceGate::shouldProcess(bool inputSilent, int numSamples) noexcept
+{
+    auto n = static_cast<juce::uint64>(numSamples);
+    samplesSeen.store(samplesSeen.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+
+    if (! inputSilent)
+    {
+        silentSamples = 0;
+
+        if (asleep)
+        {
+            asleep = false;
+            wokeUp = true;
+        }
+
+        return true;
+    }
+
+    silentSamples += numSamples;
+
+    if (! asleep)
+        return true;
+
+    samplesAsleep.store(samplesAsleep.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    return false;
+}
+
+bool SilenceGate::takeWakeUp() noexcept
+{
+    auto result = wokeUp;
+    wokeUp = false;
+    return result;
+}
+
+void SilenceGate::processed(bool outputSilent) noexcept
+{
+    // The output check catches whatever the hold time misjudged, such as
+    // a filter still ringing after a cutoff change.
+    if (outputSilent && silentSamples >= holdSamples)
+        asleep = true;
+}
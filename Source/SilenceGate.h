@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    SilenceGate.h
+
+    Puts the chain to sleep while its input is silent and its tail has
+    died away, so instances on idle tracks cost next to nothing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+//==============================================================================
+/**
+    Watches the input and output of each sub-block. Once the input has been
+    below the threshold for holdSamples in a row, and a whole processed
+    sub-block came out below it too, the gate goes to sleep and
+    shouldProcess() returns false until the input comes back. The caller
+    clears the output of skipped sub-blocks.
+
+    The filters are left holding whatever tiny state they had, so the
+    caller resets the chain when takeWakeUp() says the gate has just woken.
+    Starting from zeroed filters and settled smoothers is what the decayed
+    chain would have sounded like anyway, so there is no click.
+
+    holdSamples should cover the reported tail plus the latency, so the
+    delayed signal is out before anything is skipped.
+*/
+struct SilenceGate
+{
+    static constexpr double thresholdDecibels = -120.0;
+
+    void prepare(int newHoldSamples) noexcept;
+    void setHoldSamples(int newHoldSamples) noexcept { holdSamples = juce::jmax(0, newHoldSamples); }
+
+    // Audio thread only, in this order for each sub-block.
+    bool shouldProcess(bool inputSilent, int numSamples) noexcept;
+    bool takeWakeUp() noexcept;
+    void processed(bool outputSilent) noexcept;
+
+    bool isAsleep() const noexcept { return asleep; }
+
+    // Running totals since prepare(), for any thread. Their ratio is the
+    // share of the session's samples the chain didn't have to run.
+    juce::uint64 getNumSamplesAsleep() const noexcept { return samplesAsleep.load(std::memory_order_relaxed); }
+    juce::uint64 getNumSamplesSeen() const noexcept { return samplesSeen.load(std::memory_order_relaxed); }
+
+    template<typename SampleType>
+    static bool isSilent(const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        static const auto threshold = static_cast<SampleType>(juce::Decibels::decibelsToGain(thresholdDecibels, -1000.0));
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            auto range = juce::FloatVectorOperations::findMinAndMax(block.getChannelPointer(ch), static_cast<int>(block.getNumSamples()));
+            if (range.getStart() < -threshold || range.getEnd() > threshold)
+                return false;
+        }
+
+        return true;
+    }
+
+private:
+    int holdSamples = 0;
+    juce::int64 silentSamples = 0;
+    bool asleep = false, wokeUp = false;
+
+    // Only the audio thread writes these, so there is no need for a
+    // read-modify-write.
+    std::atomic<juce::uint64> samplesAsleep{ 0 }, samplesSeen{ 0 };
+};
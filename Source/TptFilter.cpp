@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    TptFilter.cpp
+
+  ==============================================================================
+*/
+
+#include "TptFilter.h"
+#include <cmath>
+
+CutSlopeLayout CutSlopeLayout::forSlope(FilterSlopes slope) noexcept
+{
+    auto order = static_cast<int>(slope) + 1;
+
+    CutSlopeLayout layout;
+    layout.hasOnePole = (order % 2) != 0;
+    layout.numSections = order / 2;
+
+    // Butterworth pole pairs sit at angles theta from the negative real
+    // axis, and a section's damping is 2 cos(theta).
+    for (int k = 0; k < layout.numSections; ++k)
+    {
+        auto theta = layout.hasOnePole ? juce::MathConstants<double>::pi * (k + 1) / order
+                                       : juce::MathConstants<double>::pi * (2 * k + 1) / (2 * order);
+        layout.damping[static_cast<size_t>(k)] = 2.0 * std::cos(theta);
+    }
+
+    return layout;
+}
+
+double CutSlopeLayout::getDecaySeconds(double cutoffFrequency, double attenuationDecibels) const noexcept
+{
+    // A pole pair's envelope falls as exp(-w damping t / 2), the one-pole's
+    // as exp(-w t). Adding up the time constants of the cascade overstates
+    // its ring a little, which is the safe side.
+    auto w = 2.0 * juce::MathConstants<double>::pi * juce::jmax(1.0, cutoffFrequency);
+    auto timeConstant = hasOnePole ? 1.0 / w : 0.0;
+
+    for (int k = 0; k < numSections; ++k)
+        timeConstant += 2.0 / (w * damping[static_cast<size_t>(k)]);
+
+    return timeConstant * attenuationDecibels * std::log(10.0) / 20.0;
+}
+
+//==============================================================================
+void SkewedSvfCascade::prepare(int maximumBlockSize)
+{
+    maxSteps = static_cast<size_t>(maximumBlockSize) + Vec::size() - 1;
+
+    // The rows are loaded as whole registers, so start them on a register
+    // boundary, which malloc only promises up to 16 bytes.
+    coefficients.allocate(maxSteps * rowSize + Vec::size(), true);
+    alignedCoefficients = juce::snapPointerToAlignment(coefficients.get(), Vec::SIMDRegisterSize);
+    reset();
+}
+
+void SkewedSvfCascade::setLayout(const CutSlopeLayout& newLayout) noexcept
+{
+    numSections = newLayout.numSections;
+
+    // Spare lanes still run, so give them a well-damped section.
+    for (size_t j = 0; j < damping.size(); ++j)
+        damping[j] = static_cast<int>(j) < numSections ? static_cast<float>(newLayout.damping[j]) : 2.f;
+
+    reset();
+}
+
+void SkewedSvfCascade::reset() noexcept
+{
+    ic1 = Vec(0.f);
+    ic2 = Vec(0.f);
+}
+
+size_t SkewedSvfCascade::fillCoefficients(const float* gains, float constantGain, size_t numSteps, size_t numSamples) noexcept
+{
+    jassert(numSteps <= maxSteps);
+
+    auto numRows = gains != nullptr ? juce::jmin(numSteps, maxSteps) : 1;
+
+    for (size_t t = 0; t < numRows; ++t)
+    {
+        auto* a1 = alignedCoefficients + t * rowSize;
+        auto* a2 = a1 + Vec::size();
+        auto* a3 = a2 + Vec::size();
+        auto* k = a3 + Vec::size();
+
+        // Lane j is on sample t - j. Idle lanes can take any valid g.
+        for (size_t j = 0; j < Vec::size(); ++j)
+        {
+            auto g = gains != nullptr ? gains[t >= j ? juce::jmin(t - j, numSamples - 1) : 0] : constantGain;
+            a1[j] = 1.f / (1.f + g * (g + damping[j]));
+            a2[j] = g * a1[j];
+            a3[j] = g * a2[j];
+            k[j] = damping[j];
+        }
+    }
+
+    return gains != nullptr ? rowSize : 0;
+}
+
+void SkewedSvfCascade::holdIdleLanes(Vec held1, Vec held2, size_t t, size_t numSamples) noexcept
+{
+    for (size_t j = 0; j < Vec::size(); ++j)
+    {
+        if (j > t || t - j >= numSamples)
+        {
+            ic1.set(j, held1.get(j));
+            ic2.set(j, held2.get(j));
+        }
+    }
+}
@@ -0,0 +1,488 @@
+/*
+  ==============================================================================
+
+    TptFilter.h
+
+    Topology-preserving-transform (TPT) cut filters, from 6 to 48 dB/oct,
+    whose cutoff can move every sample for zipper-free automation of the
+    cut stages.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cmath>
+#include <type_traits>
+
+enum CutFilterTypes
+{
+    LowPassCut,
+    HighPassCut
+};
+
+enum FilterSlopes
+{
+    Slope6,
+    Slope12,
+    Slope18,
+    Slope24,
+    Slope30,
+    Slope36,
+    Slope42,
+    Slope48
+};
+
+//==============================================================================
+/**
+    Smooths a cutoff frequency as the prewarped TPT gain g = tan(pi * fc / fs),
+    which every filter in this file is driven by. NumericType is float, or
+    double for the double-precision chain, where a 20 Hz cut at 192 kHz
+    wants g = 3.3e-4 to more than float's seven digits.
+
+    The tan is only evaluated when the target changes. While moving, g
+    glides multiplicatively, which sweeps evenly in pitch across the band.
+    getNextRamp() writes one g per sample so several filters (or all the
+    lanes of a SIMD filter) can share one ramp.
+*/
+template<typename NumericType>
+struct CutoffSmoother
+{
+    static constexpr double defaultRampSeconds = 0.05;
+
+    void prepare(double newSampleRate, int maximumBlockSize)
+    {
+        sampleRate = newSampleRate;
+
+        ramp.allocate(static_cast<size_t>(maximumBlockSize), true);
+        rampCapacity = maximumBlockSize;
+
+        gain.reset(sampleRate, defaultRampSeconds);
+    }
+
+    void reset() noexcept { gain.setCurrentAndTargetValue(gain.getTargetValue()); }
+
+    void setCutoffFrequency(float frequency) noexcept
+    {
+        // Keep clear of Nyquist, where tan blows up.
+        auto fc = juce::jlimit(1.0, 0.49 * sampleRate, static_cast<double>(frequency));
+        gain.setTargetValue(static_cast<NumericType>(std::tan(juce::MathConstants<double>::pi * fc / sampleRate)));
+    }
+
+    bool isSmoothing() const noexcept { return gain.isSmoothing(); }
+    NumericType getCurrentGain() const noexcept { return gain.getCurrentValue(); }
+    void skip(int numSamples) noexcept { gain.skip(numSamples); }
+
+    // Fills and returns the g for each of the next numSamples samples, or
+    // returns nullptr when g is steady at getCurrentGain().
+    const NumericType* getNextRamp(int numSamples) noexcept
+    {
+        if (! gain.isSmoothing())
+            return nullptr;
+
+        jassert(numSamples <= rampCapacity);
+        numSamples = juce::jmin(numSamples, rampCapacity);
+
+        for (int i = 0; i < numSamples; ++i)
+            ramp[i] = gain.getNextValue();
+
+        return ramp.get();
+    }
+
+private:
+    juce::SmoothedValue<NumericType, juce::ValueSmoothingTypes::Multiplicative> gain{ 1 };
+    juce::HeapBlock<NumericType> ramp;
+    int rampCapacity = 0;
+    double sampleRate = 44100.0;
+};
+
+//==============================================================================
+/**
+    How a Butterworth cut of a given slope splits into sections: a one-pole
+    for odd orders, then one state-variable section per pole pair, each
+    with its own damping (1 / Q).
+*/
+struct CutSlopeLayout
+{
+    static constexpr int maxSections = 4;
+
+    static CutSlopeLayout forSlope(FilterSlopes slope) noexcept;
+
+    // How long the cascade rings at a given cutoff before its impulse
+    // response has fallen by attenuationDecibels.
+    double getDecaySeconds(double cutoffFrequency, double attenuationDecibels) const noexcept;
+
+    bool hasOnePole = false;
+    int numSections = 0;
+    std::array<double, maxSections> damping{};
+};
+
+//==============================================================================
+/**
+    The TPT one-pole, templated so the same code runs on float, double or
+    SIMDRegister<float> lanes. At a fixed cutoff it matches the bilinear
+    first-order filters from IIR::ArrayCoefficients exactly.
+*/
+template<typename SampleType>
+struct TptOnePole
+{
+    using NumericType = typename juce::dsp::SampleTypeHelpers::ElementType<SampleType>::Type;
+
+    void reset() noexcept { state = SampleType(); }
+
+    // Filters in place with one g per sample, or with constantGain
+    // throughout when gains is nullptr.
+    template<CutFilterTypes type>
+    void process(SampleType* data, size_t numSamples, const NumericType* gains, NumericType constantGain) noexcept
+    {
+        if (gains == nullptr)
+        {
+            auto G = constantGain / (1 + constantGain);
+            run<type>(data, numSamples, [G](size_t) { return G; });
+        }
+        else
+        {
+            run<type>(data, numSamples, [gains](size_t i) { return gains[i] / (1 + gains[i]); });
+        }
+    }
+
+    template<CutFilterTypes type>
+    SampleType processSample(SampleType x, NumericType G) noexcept
+    {
+        auto v = (x - state) * G;
+        auto lowPass = v + state;
+        state = lowPass + v;
+
+        if constexpr (type == CutFilterTypes::HighPassCut)
+            return x - lowPass;
+        else
+            return lowPass;
+    }
+
+private:
+    template<CutFilterTypes type, typename GainFn>
+    void run(SampleType* data, size_t numSamples, GainFn&& gainAt) noexcept
+    {
+        for (size_t i = 0; i < numSamples; ++i)
+            data[i] = processSample<type>(data[i], gainAt(i));
+    }
+
+    SampleType state{};
+};
+
+//==============================================================================
+/**
+    Coefficients of one TPT state-variable section. CoefficientType is float
+    or double, or a SIMDRegister when each lane is a different section.
+*/
+template<typename CoefficientType>
+struct SvfCoefficients
+{
+    static SvfCoefficients make(CoefficientType g, CoefficientType damping) noexcept
+    {
+        SvfCoefficients c;
+        c.a1 = 1 / (1 + g * (g + damping));
+        c.a2 = g * c.a1;
+        c.a3 = g * c.a2;
+        c.damping = damping;
+        return c;
+    }
+
+    CoefficientType a1{}, a2{}, a3{}, damping{};
+};
+
+// One sample through a TPT state-variable section (Zavalishin, Simper).
+template<CutFilterTypes type, typename SampleType, typename CoefficientType>
+SampleType tickSvf(SampleType x, SampleType& ic1, SampleType& ic2, const SvfCoefficients<CoefficientType>& c) noexcept
+{
+    auto v3 = x - ic2;
+    auto v1 = ic1 * c.a1 + v3 * c.a2;
+    auto v2 = ic2 + ic1 * c.a2 + v3 * c.a3;
+    ic1 = v1 * 2 - ic1;
+    ic2 = v2 * 2 - ic2;
+
+    if constexpr (type == CutFilterTypes::HighPassCut)
+        return x - v1 * c.damping - v2;
+    else
+        return v2;
+}
+
+//==============================================================================
+/**
+    A whole cut of any slope on one SampleType stream, with the sections run
+    one after another over the block. With SIMDRegister<float> samples every
+    lane is a channel, so this is what VectorChain uses; with double it is
+    the whole of the double-precision TptCutFilter.
+*/
+template<typename SampleType>
+struct TptCutCascade
+{
+    using NumericType = typename juce::dsp::SampleTypeHelpers::ElementType<SampleType>::Type;
+
+    void setSlope(FilterSlopes newSlope) noexcept
+    {
+        if (newSlope == slope)
+            return;
+
+        slope = newSlope;
+        layout = CutSlopeLayout::forSlope(slope);
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        onePole.reset();
+        for (auto& section : sections)
+            section.ic1 = section.ic2 = SampleType();
+    }
+
+    template<CutFilterTypes type>
+    void process(SampleType* data, size_t numSamples, const NumericType* gains, NumericType constantGain) noexcept
+    {
+        if (layout.hasOnePole)
+            onePole.template process<type>(data, numSamples, gains, constantGain);
+
+        for (int s = 0; s < layout.numSections; ++s)
+        {
+            auto& section = sections[static_cast<size_t>(s)];
+            auto damping = static_cast<NumericType>(layout.damping[static_cast<size_t>(s)]);
+
+            if (gains == nullptr)
+            {
+                auto c = SvfCoefficients<NumericType>::make(constantGain, damping);
+                for (size_t i = 0; i < numSamples; ++i)
+                    data[i] = tickSvf<type>(data[i], section.ic1, section.ic2, c);
+            }
+            else
+            {
+                for (size_t i = 0; i < numSamples; ++i)
+                    data[i] = tickSvf<type>(data[i], section.ic1, section.ic2, SvfCoefficients<NumericType>::make(gains[i], damping));
+            }
+        }
+    }
+
+private:
+    struct Section
+    {
+        SampleType ic1{}, ic2{};
+    };
+
+    FilterSlopes slope{ FilterSlopes::Slope6 };
+    CutSlopeLayout layout{ CutSlopeLayout::forSlope(FilterSlopes::Slope6) };
+    TptOnePole<SampleType> onePole;
+    std::array<Section, CutSlopeLayout::maxSections> sections;
+};
+
+//==============================================================================
+/**
+    Up to four state-variable sections of a single channel, one per
+    SIMDRegister lane, run as a skewed pipeline: at step t lane j works on
+    sample t - j, taking its input from lane j - 1's output of the step
+    before. A 48 dB/oct cut then costs one vector section per sample rather
+    than four scalar ones.
+
+    The pipeline fills at the start of each block and drains at the end, so
+    it adds no latency. Lanes with no sample to work on during those steps
+    keep their state. Lanes past the last section, which is all but four of
+    them in an AVX build, run a well-damped section nobody reads.
+*/
+struct SkewedSvfCascade
+{
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static_assert(Vec::size() >= CutSlopeLayout::maxSections, "one section per lane");
+
+    void prepare(int maximumBlockSize);
+
+    // Clears the state, as the sections no longer line up with the lanes.
+    void setLayout(const CutSlopeLayout& newLayout) noexcept;
+    void reset() noexcept;
+
+    template<CutFilterTypes type>
+    void process(float* data, size_t numSamples, const float* gains, float constantGain) noexcept
+    {
+        if (numSections == 0 || numSamples == 0)
+            return;
+
+        // A lone section has nothing to overlap with, so it runs faster as
+        // plain scalar code.
+        if (numSections == 1)
+        {
+            processSingleSection<type>(data, numSamples, gains, constantGain);
+            return;
+        }
+
+        auto last = static_cast<size_t>(numSections - 1);
+        auto numSteps = numSamples + last;
+        auto stride = fillCoefficients(gains, constantGain, numSteps, numSamples);
+
+        // Each lane's output from the step before, which the next lane
+        // along takes as its input.
+        alignas(Vec::SIMDRegisterSize) float previous[Vec::size()]{};
+        alignas(Vec::SIMDRegisterSize) float input[Vec::size()];
+
+        for (size_t t = 0; t < numSteps; ++t)
+        {
+            input[0] = t < numSamples ? data[t] : 0.f;
+            for (size_t j = 1; j < Vec::size(); ++j)
+                input[j] = previous[j - 1];
+
+            auto x = Vec::fromRawArray(input);
+            auto held1 = ic1, held2 = ic2;
+
+            auto y = tickSvf<type>(x, ic1, ic2, loadCoefficients(t * stride));
+
+            if (t < last || t >= numSamples)
+                holdIdleLanes(held1, held2, t, numSamples);
+
+            y.copyToRawArray(previous);
+
+            if (t >= last)
+                data[t - last] = previous[last];
+        }
+    }
+
+private:
+    static constexpr size_t rowSize = 4 * Vec::size();
+
+    template<CutFilterTypes type>
+    void processSingleSection(float* data, size_t numSamples, const float* gains, float constantGain) noexcept
+    {
+        auto s1 = ic1.get(0), s2 = ic2.get(0);
+
+        if (gains == nullptr)
+        {
+            auto c = SvfCoefficients<float>::make(constantGain, damping[0]);
+            for (size_t i = 0; i < numSamples; ++i)
+                data[i] = tickSvf<type>(data[i], s1, s2, c);
+        }
+        else
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+                data[i] = tickSvf<type>(data[i], s1, s2, SvfCoefficients<float>::make(gains[i], damping[0]));
+        }
+
+        ic1.set(0, s1);
+        ic2.set(0, s2);
+    }
+
+    // Works out every lane's coefficients for each step up front, so the
+    // divides stay out of the pipeline's dependency chain. Returns the
+    // distance between rows, which is 0 when the cutoff is steady.
+    size_t fillCoefficients(const float* gains, float constantGain, size_t numSteps, size_t numSamples) noexcept;
+
+    SvfCoefficients<Vec> loadCoefficients(size_t offset) const noexcept
+    {
+        auto* row = alignedCoefficients + offset;
+
+        SvfCoefficients<Vec> c;
+        c.a1 = Vec::fromRawArray(row);
+        c.a2 = Vec::fromRawArray(row + Vec::size());
+        c.a3 = Vec::fromRawArray(row + 2 * Vec::size());
+        c.damping = Vec::fromRawArray(row + 3 * Vec::size());
+        return c;
+    }
+
+    // Puts back the state of lanes that had no sample at step t.
+    void holdIdleLanes(Vec held1, Vec held2, size_t t, size_t numSamples) noexcept;
+
+    Vec ic1{}, ic2{};
+    int numSections = 0;
+    juce::HeapBlock<float> coefficients;
+    float* alignedCoefficients = nullptr;
+    size_t maxSteps = 0;
+    std::array<float, Vec::size()> damping{};
+};
+
+//==============================================================================
+/**
+    A ProcessorChain stage: one channel of cut filter at any slope, driven by
+    its own CutoffSmoother. Setting the cutoff never touches filter state, so
+    it is safe to do from the audio thread every block.
+
+    In float, odd orders start with a TptOnePole and the pole pairs go
+    through a SkewedSvfCascade. There is no four-lane double register to
+    skew across, so in double the whole cut is a TptCutCascade.
+*/
+template<CutFilterTypes type, typename SampleType = float>
+struct TptCutFilter
+{
+    static constexpr bool usesSkewedCascade = std::is_same_v<SampleType, float>;
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        jassert(spec.numChannels == 1);
+        smoother.prepare(spec.sampleRate, static_cast<int>(spec.maximumBlockSize));
+        onePole.reset();
+
+        if constexpr (usesSkewedCascade)
+            cascade.prepare(static_cast<int>(spec.maximumBlockSize));
+        else
+            cascade.reset();
+    }
+
+    void reset() noexcept
+    {
+        smoother.reset();
+        onePole.reset();
+        cascade.reset();
+    }
+
+    void setCutoffFrequency(float frequency) noexcept { smoother.setCutoffFrequency(frequency); }
+
+    void setSlope(FilterSlopes newSlope) noexcept
+    {
+        if (newSlope == slope)
+            return;
+
+        slope = newSlope;
+        layout = CutSlopeLayout::forSlope(slope);
+        onePole.reset();
+
+        if constexpr (usesSkewedCascade)
+            cascade.setLayout(layout);
+        else
+            cascade.setSlope(slope);
+    }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        auto&& inBlock = context.getInputBlock();
+        auto&& outBlock = context.getOutputBlock();
+        auto numSamples = outBlock.getNumSamples();
+
+        jassert(inBlock.getNumChannels() == 1 && outBlock.getNumChannels() == 1);
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outBlock.copyFrom(inBlock);
+
+        // Bypassed stages still follow the cutoff, so there is no glide
+        // from a stale value when they come back.
+        if (context.isBypassed)
+        {
+            smoother.skip(static_cast<int>(numSamples));
+            return;
+        }
+
+        auto* data = outBlock.getChannelPointer(0);
+        auto* ramp = smoother.getNextRamp(static_cast<int>(numSamples));
+        auto gain = smoother.getCurrentGain();
+
+        if constexpr (usesSkewedCascade)
+            if (layout.hasOnePole)
+                onePole.template process<type>(data, numSamples, ramp, gain);
+
+        cascade.template process<type>(data, numSamples, ramp, gain);
+    }
+
+private:
+    using Cascade = std::conditional_t<usesSkewedCascade, SkewedSvfCascade, TptCutCascade<SampleType>>;
+
+    CutoffSmoother<SampleType> smoother;
+    FilterSlopes slope{ FilterSlopes::Slope6 };
+    CutSlopeLayout layout{ CutSlopeLayout::forSlope(FilterSlopes::Slope6) };
+    TptOnePole<SampleType> onePole;
+    Cascade cascade;
+};
@@ -0,0 +1,369 @@
+/*
+  ==============================================================================
+
+    VectorChain.cpp
+
+  ==============================================================================
+*/
+
+#include "VectorChain.h"
+
+void VectorChain::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    auto numChannels = static_cast<int>(spec.numChannels);
+    auto numGroups = (numChannels + static_cast<int>(lanes) - 1) / static_cast<int>(lanes);
+
+    groups.clear();
+    groups.resize(static_cast<size_t>(numGroups));
+
+    for (int i = 0; i < numGroups; ++i)
+    {
+        auto& group = groups[static_cast<size_t>(i)];
+        group.firstChannel = i * static_cast<int>(lanes);
+        group.numChannels = juce::jmin(static_cast<int>(lanes), numChannels - group.firstChannel);
+        group.lowCut.reset();
+        group.highCut.reset();
+        group.preMeter.prepare(spec.sampleRate, static_cast<int>(spec.maximumBlockSize));
+        group.postMeter.prepare(spec.sampleRate, static_cast<int>(spec.maximumBlockSize));
+
+        juce::dsp::ProcessSpec shaperSpec = spec;
+        shaperSpec.numChannels = static_cast<juce::uint32>(group.numChannels);
+        group.shaper.prepare(shaperSpec);
+
+        group.interleaved = juce::dsp::AudioBlock<Vec>(group.interleavedData, 1, spec.maximumBlockSize);
+        group.interleaved.clear();
+    }
+
+    auto maxBlock = static_cast<int>(spec.maximumBlockSize);
+    lowCutSmoother.prepare(spec.sampleRate, maxBlock);
+    highCutSmoother.prepare(spec.sampleRate, maxBlock);
+
+    inGain.reset(spec.sampleRate, CutoffSmoother<float>::defaultRampSeconds);
+    outGain.reset(spec.sampleRate, CutoffSmoother<float>::defaultRampSeconds);
+    inGainRamp.allocate(spec.maximumBlockSize, true);
+    outGainRamp.allocate(spec.maximumBlockSize, true);
+
+    preShaper.setSize(numChannels, static_cast<int>(spec.maximumBlockSize), false, true, false);
+    shaped.setSize(numChannels, static_cast<int>(spec.maximumBlockSize), false, true, false);
+    numPreShaperSamples = 0;
+}
+
+void VectorChain::reset()
+{
+    lowCutSmoother.reset();
+    highCutSmoother.reset();
+    inGain.setCurrentAndTargetValue(inGain.getTargetValue());
+    outGain.setCurrentAndTargetValue(outGain.getTargetValue());
+
+    for (auto& group : groups)
+    {
+        group.lowCut.reset();
+        group.highCut.reset();
+        group.shaper.reset();
+        group.preMeter.reset();
+        group.postMeter.reset();
+    }
+}
+
+MeterLevels VectorChain::getMeterLevels(MeterPoints point) const noexcept
+{
+    MeterLevels levels;
+
+    for (const auto& group : groups)
+    {
+        const auto& meter = point == MeterPoints::PreShaperPoint ? group.preMeter : group.postMeter;
+        for (int lane = 0; lane < group.numChannels; ++lane)
+            levels.combine(meter.getLevels(static_cast<size_t>(lane)));
+    }
+
+    return levels;
+}
+
+void VectorChain::setLowCutSlope(FilterSlopes slope) noexcept
+{
+    for (auto& group : groups)
+        group.lowCut.setSlope(slope);
+}
+
+void VectorChain::setHighCutSlope(FilterSlopes slope) noexcept
+{
+    for (auto& group : groups)
+        group.highCut.setSlope(slope);
+}
+
+void VectorChain::setDistType(DistTypes newType) noexcept
+{
+    distType = newType;
+
+    for (auto& group : groups)
+        group.shaper.setDistType(newType);
+}
+
+void VectorChain::setAccuracyTier(AccuracyTiers newTier) noexcept
+{
+    accuracyTier = newTier;
+
+    for (auto& group : groups)
+        group.shaper.setAccuracyTier(newTier);
+}
+
+void VectorChain::setCustomCurve(const CustomCurveTable* newCurve) noexcept
+{
+    for (auto& group : groups)
+        group.shaper.setCustomCurve(newCurve);
+}
+
+void VectorChain::setOversampling(int order, bool linearPhase) noexcept
+{
+    for (auto& group : groups)
+        group.shaper.setOversampling(order, linearPhase);
+}
+
+void VectorChain::setAntialiasing(AntialiasingModes newMode) noexcept
+{
+    for (auto& group : groups)
+        group.shaper.setAntialiasing(newMode);
+}
+
+void VectorChain::setMultiband(const MultibandSettings& newSettings) noexcept
+{
+    for (auto& group : groups)
+        group.shaper.setMultiband(newSettings);
+}
+
+VectorChain::BlockRamps VectorChain::getNextRamps(int numSamples) noexcept
+{
+    BlockRamps ramps;
+
+    // Bypassed cut stages keep following their cutoff without filtering.
+    auto cutRamp = [numSamples](CutoffSmoother<float>& smoother, bool bypassed)
+    {
+        Ramp ramp;
+        if (bypassed)
+            smoother.skip(numSamples);
+        else
+            ramp.values = smoother.getNextRamp(numSamples);
+        ramp.constant = smoother.getCurrentGain();
+        return ramp;
+    };
+
+    auto gainRamp = [numSamples](juce::SmoothedValue<float>& gain, float* storage)
+    {
+        Ramp ramp;
+        if (gain.isSmoothing())
+        {
+            for (int i = 0; i < numSamples; ++i)
+                storage[i] = gain.getNextValue();
+            ramp.values = storage;
+        }
+        ramp.constant = gain.getCurrentValue();
+        return ramp;
+    };
+
+    ramps.lowCut = cutRamp(lowCutSmoother, lowCutBypassed);
+    ramps.highCut = cutRamp(highCutSmoother, highCutBypassed);
+    ramps.inGain = gainRamp(inGain, inGainRamp.get());
+    ramps.outGain = gainRamp(outGain, outGainRamp.get());
+    return ramps;
+}
+
+void VectorChain::process(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    numPreShaperSamples = static_cast<int>(block.getNumSamples());
+    auto ramps = getNextRamps(numPreShaperSamples);
+    auto kernel = selectKernel();
+
+    for (auto& group : groups)
+        (this->*kernel)(group, block, ramps);
+}
+
+void VectorChain::process(const juce::dsp::AudioBlock<float>& block, RealtimeWorkerPool& pool) noexcept
+{
+    numPreShaperSamples = static_cast<int>(block.getNumSamples());
+    auto ramps = getNextRamps(numPreShaperSamples);
+
+    auto kernel = selectKernel();
+
+    auto job = [this, kernel, &block, &ramps](int index) { (this->*kernel)(groups[static_cast<size_t>(index)], block, ramps); };
+    pool.run(static_cast<int>(groups.size()), job);
+}
+
+VectorChain::GroupKernel VectorChain::selectKernel() const noexcept
+{
+    static constexpr auto kernels = makeKernels(std::make_index_sequence<numKernels>());
+
+    auto index = (static_cast<int>(distType) * numTiers + static_cast<int>(accuracyTier)) * 8
+               + (lowCutBypassed ? 1 : 0) + (highCutBypassed ? 2 : 0) + (distortionBypassed ? 4 : 0);
+
+    return kernels[static_cast<size_t>(index)];
+}
+
+template<DistTypes type, AccuracyTiers tier, bool lowCutActive, bool highCutActive, bool shaperActive>
+void VectorChain::processGroupAs(LaneGroup& group, const juce::dsp::AudioBlock<float>& block, const BlockRamps& ramps) noexcept
+{
+    auto numSamples = block.getNumSamples();
+    jassert(numSamples <= group.interleaved.getNumSamples());
+
+    auto numChannels = juce::jmin(static_cast<int>(block.getNumChannels()), preShaper.getNumChannels());
+    auto groupChannels = juce::jmin(group.numChannels, numChannels - group.firstChannel);
+    if (groupChannels <= 0)
+        return;
+
+    auto workBlock = group.interleaved.getSubBlock(0, numSamples);
+    auto* vecs = workBlock.getChannelPointer(0);
+    auto* samples = reinterpret_cast<float*>(vecs);
+
+    auto interleave = [&](auto getSource)
+    {
+        // Unused lanes are zeroed so the shaper and filters run on silence.
+        if (groupChannels < static_cast<int>(lanes))
+            workBlock.clear();
+
+        for (int lane = 0; lane < groupChannels; ++lane)
+        {
+            const float* src = getSource(group.firstChannel + lane);
+            for (size_t i = 0; i < numSamples; ++i)
+                samples[i * lanes + static_cast<size_t>(lane)] = src[i];
+        }
+    };
+
+    auto deinterleave = [&](auto getDest)
+    {
+        for (int lane = 0; lane < groupChannels; ++lane)
+        {
+            float* dest = getDest(group.firstChannel + lane);
+            for (size_t i = 0; i < numSamples; ++i)
+                dest[i] = samples[i * lanes + static_cast<size_t>(lane)];
+        }
+    };
+
+    auto blockChannel = [&block](int ch) { return block.getChannelPointer(static_cast<size_t>(ch)); };
+    auto preShaperChannel = [this](int ch) { return preShaper.getWritePointer(ch); };
+    auto shapedChannel = [this](int ch) { return shaped.getWritePointer(ch); };
+
+    auto applyGain = [vecs, numSamples](const Ramp& gain)
+    {
+        if (gain.values != nullptr)
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+                vecs[i] *= gain.values[i];
+        }
+        else
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+                vecs[i] *= gain.constant;
+        }
+    };
+
+    // Gain, curve and gain in one pass, a register at a time.
+    auto applyGainsAndCurve = [&group, vecs, numSamples](auto inGainAt, auto outGainAt)
+    {
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto in = inGainAt(i);
+            auto out = outGainAt(i);
+
+            if constexpr (shaperActive)
+                vecs[i] = group.shaper.template processSampleAs<type, tier>(vecs[i] * in) * out;
+            else
+                vecs[i] *= in * out;
+        }
+    };
+
+    auto rampedGain = [](const Ramp& gain) { return [values = gain.values](size_t i) { return values[i]; }; };
+    auto constantGain = [](const Ramp& gain) { return [constant = gain.constant](size_t) { return constant; }; };
+
+    interleave(blockChannel);
+
+    if constexpr (lowCutActive)
+    {
+        ChainProfiler::ScopedStage timing(profiler, ChainPositions::LowCut);
+        group.lowCut.template process<CutFilterTypes::HighPassCut>(vecs, numSamples, ramps.lowCut.values, ramps.lowCut.constant);
+    }
+
+    auto separateChannels = group.shaper.needsSeparateChannels();
+
+    if (! separateChannels && ! meteringEnabled && ! preShaperCaptureEnabled)
+    {
+        ChainProfiler::ScopedStage timing(profiler, ChainPositions::WaveShape);
+        const auto& in = ramps.inGain;
+        const auto& out = ramps.outGain;
+
+        if (in.values != nullptr && out.values != nullptr)
+            applyGainsAndCurve(rampedGain(in), rampedGain(out));
+        else if (in.values != nullptr)
+            applyGainsAndCurve(rampedGain(in), constantGain(out));
+        else if (out.values != nullptr)
+            applyGainsAndCurve(constantGain(in), rampedGain(out));
+        else
+            applyGainsAndCurve(constantGain(in), constantGain(out));
+    }
+    else
+    {
+        {
+            ChainProfiler::ScopedStage timing(profiler, ChainPositions::GainIn);
+            applyGain(ramps.inGain);
+        }
+
+        if (meteringEnabled)
+        {
+            ChainProfiler::ScopedStage timing(profiler, ChainPositions::PreMeter);
+            group.preMeter.process(vecs, numSamples);
+        }
+
+        // Split out for the capture alone, this is FifoBlock's work.
+        if (preShaperCaptureEnabled && ! separateChannels)
+        {
+            ChainProfiler::ScopedStage timing(profiler, ChainPositions::FifoBlk);
+            deinterleave(preShaperChannel);
+        }
+
+        if (! separateChannels)
+        {
+            // The curve runs straight over the interleaved registers.
+            if constexpr (shaperActive)
+            {
+                ChainProfiler::ScopedStage timing(profiler, ChainPositions::WaveShape);
+                for (size_t i = 0; i < numSamples; ++i)
+                    vecs[i] = group.shaper.template processSampleAs<type, tier>(vecs[i]);
+            }
+        }
+        else
+        {
+            ChainProfiler::ScopedStage timing(profiler, ChainPositions::WaveShape);
+            deinterleave(preShaperChannel);
+
+            // The oversamplers and ADAA state work on separate channels, so
+            // the shaper runs on this group's channels of the pre-shaper
+            // buffer. Bypassed, it still runs the oversampling filters so
+            // the latency stays put.
+            auto groupFirst = static_cast<size_t>(group.firstChannel);
+            auto groupCount = static_cast<size_t>(groupChannels);
+            auto preShaperBlock = juce::dsp::AudioBlock<float>(preShaper).getSubsetChannelBlock(groupFirst, groupCount).getSubBlock(0, numSamples);
+            auto shapedBlock = juce::dsp::AudioBlock<float>(shaped).getSubsetChannelBlock(groupFirst, groupCount).getSubBlock(0, numSamples);
+            juce::dsp::AudioBlock<const float> shaperInput(preShaperBlock);
+            juce::dsp::ProcessContextNonReplacing<float> shaperContext(shaperInput, shapedBlock);
+            shaperContext.isBypassed = ! shaperActive;
+            group.shaper.process(shaperContext);
+
+            interleave(shapedChannel);
+        }
+
+        if (meteringEnabled)
+        {
+            ChainProfiler::ScopedStage timing(profiler, ChainPositions::PostMeter);
+            group.postMeter.process(vecs, numSamples);
+        }
+
+        ChainProfiler::ScopedStage timing(profiler, ChainPositions::GainOut);
+        applyGain(ramps.outGain);
+    }
+
+    if constexpr (highCutActive)
+    {
+        ChainProfiler::ScopedStage timing(profiler, ChainPositions::HighCut);
+        group.highCut.template process<CutFilterTypes::LowPassCut>(vecs, numSamples, ramps.highCut.values, ramps.highCut.constant);
+    }
+
+    deinterleave(blockChannel);
+}
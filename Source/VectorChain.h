@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    VectorChain.h
+
+    The processing chain run across all channels at once, with channels
+    interleaved into SIMDRegister lanes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <utility>
+#include <vector>
+#include "OversampledWaveShaper.h"
+#include "RealtimeWorkerPool.h"
+#include "TptFilter.h"
+#include "LevelMeter.h"
+#include "ChainProfiler.h"
+
+// The stages of the processor's per-channel MonoChain, in order. The
+// passes of VectorChain stand for the same stages, and ChainProfiler
+// keeps one histogram per stage.
+enum ChainPositions
+{
+    LowCut,
+    GainIn,
+    FifoBlk,
+    PreMeter,
+    WaveShape,
+    PostMeter,
+    GainOut,
+    HighCut
+};
+
+//==============================================================================
+/**
+    Runs LowCut -> GainIn -> WaveShape -> GainOut -> HighCut for every channel
+    of a block in one pass.
+
+    Channels are packed into groups of SIMDRegister<float>::size() lanes (a
+    stereo bus fills two lanes of one register; wider buses fill as many
+    registers as they need). Each group goes through one vectorised TPT
+    cascade per cut stage and one run of the curve over its interleaved
+    registers, so a single pass serves all channels of the group.
+    When the shaper is oversampled, uses ADAA or is split into bands it runs
+    on the group's de-interleaved channels instead.
+
+    Cutoffs and gains glide per sample. Each block, their ramps are worked
+    out once and shared by every group.
+
+    Each group runs one of 88 kernels, one per curve, accuracy tier and
+    bypass combination (only ArcTan and HypTan have tiers), with the choices
+    fixed at compile time. The kernel is picked once per block. When
+    nothing needs the signal between the gains (no meters, no capture, no
+    oversampling or ADAA), the input gain, curve and output gain run as one
+    pass.
+
+    Groups share no state, so with a RealtimeWorkerPool they are processed
+    in parallel.
+
+    Given a ChainProfiler, every pass of every group is timed into the
+    histogram of the stage it stands for.
+
+    The per-channel MonoChain path in the processor is kept as the reference
+    that this chain's output is compared against, in Tools/ChainTests.
+*/
+struct VectorChain
+{
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    static constexpr size_t lanes = Vec::size();
+
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
+    void process(const juce::dsp::AudioBlock<float>& block) noexcept;
+    void process(const juce::dsp::AudioBlock<float>& block, RealtimeWorkerPool& pool) noexcept;
+
+    void setLowCutFrequency(float frequency) noexcept { lowCutSmoother.setCutoffFrequency(frequency); }
+    void setHighCutFrequency(float frequency) noexcept { highCutSmoother.setCutoffFrequency(frequency); }
+    void setLowCutSlope(FilterSlopes slope) noexcept;
+    void setHighCutSlope(FilterSlopes slope) noexcept;
+    void setLowCutBypassed(bool shouldBeBypassed) noexcept { lowCutBypassed = shouldBeBypassed; }
+    void setHighCutBypassed(bool shouldBeBypassed) noexcept { highCutBypassed = shouldBeBypassed; }
+
+    void setInputGainDecibels(float gainDecibels) noexcept { inGain.setTargetValue(juce::Decibels::decibelsToGain(gainDecibels)); }
+    void setOutputGainDecibels(float gainDecibels) noexcept { outGain.setTargetValue(juce::Decibels::decibelsToGain(gainDecibels)); }
+
+    // Meters the signal going into and coming out of the shaper.
+    void setMeteringEnabled(bool shouldMeter) noexcept { meteringEnabled = shouldMeter; }
+    MeterLevels getMeterLevels(MeterPoints point) const noexcept;
+
+    void setDistType(DistTypes newType) noexcept;
+    void setAccuracyTier(AccuracyTiers newTier) noexcept;
+    void setCustomCurve(const CustomCurveTable* newCurve) noexcept;
+    void setOversampling(int order, bool linearPhase) noexcept;
+    void setAntialiasing(AntialiasingModes newMode) noexcept;
+    void setMultiband(const MultibandSettings& newSettings) noexcept;
+    void setDistortionBypassed(bool shouldBeBypassed) noexcept { distortionBypassed = shouldBeBypassed; }
+
+    // Off the audio thread. nullptr stops the timing.
+    void setProfiler(ChainProfiler* newProfiler) noexcept { profiler = newProfiler; }
+
+    // The signal just before the shaper for the last processed block, one
+    // channel per input channel. This is what FifoBlock captures in the
+    // reference path. Only kept up to date while capture is enabled.
+    void setPreShaperCaptureEnabled(bool shouldCapture) noexcept { preShaperCaptureEnabled = shouldCapture; }
+    const juce::AudioBuffer<float>& getPreShaperBuffer() const noexcept { return preShaper; }
+    int getNumPreShaperSamples() const noexcept { return numPreShaperSamples; }
+
+private:
+    struct LaneGroup
+    {
+        TptCutCascade<Vec> lowCut, highCut;
+        OversampledWaveShaper<float> shaper;
+        LevelMeter<Vec> preMeter, postMeter;
+        juce::HeapBlock<char> interleavedData;
+        juce::dsp::AudioBlock<Vec> interleaved;
+        int firstChannel = 0;
+        int numChannels = 0;
+    };
+
+    // Per-sample values for one block, or nullptr with a constant.
+    struct Ramp
+    {
+        const float* values = nullptr;
+        float constant = 1.f;
+    };
+
+    struct BlockRamps
+    {
+        Ramp lowCut, highCut, inGain, outGain;
+    };
+
+    BlockRamps getNextRamps(int numSamples) noexcept;
+
+    using GroupKernel = void (VectorChain::*)(LaneGroup&, const juce::dsp::AudioBlock<float>&, const BlockRamps&) noexcept;
+    static constexpr int numTiers = AccuracyTiers::ExactTier + 1;
+    static constexpr int numKernels = (DistTypes::Custom + 1) * numTiers * 8;
+
+    template<DistTypes type, AccuracyTiers tier, bool lowCutActive, bool highCutActive, bool shaperActive>
+    void processGroupAs(LaneGroup& group, const juce::dsp::AudioBlock<float>& block, const BlockRamps& ramps) noexcept;
+
+    // Kernel index = (curve * numTiers + tier) * 8 + low cut bypassed
+    // + 2 * high cut bypassed + 4 * distortion bypassed. Curves without
+    // tiers share their Standard kernel across all three.
+    static constexpr DistTypes getKernelType(size_t index) noexcept
+    {
+        return static_cast<DistTypes>(index / (8 * numTiers));
+    }
+
+    static constexpr AccuracyTiers getKernelTier(size_t index) noexcept
+    {
+        return CurveShaper::hasAccuracyTiers(getKernelType(index)) ? static_cast<AccuracyTiers>(index / 8 % numTiers)
+                                                                       : AccuracyTiers::StandardTier;
+    }
+
+    template<size_t... indices>
+    static constexpr std::array<GroupKernel, numKernels> makeKernels(std::index_sequence<indices...>) noexcept
+    {
+        return { &VectorChain::processGroupAs<getKernelType(indices), getKernelTier(indices),
+                                              (indices & 1) == 0, (indices & 2) == 0, (indices & 4) == 0>... };
+    }
+
+    GroupKernel selectKernel() const noexcept;
+
+    std::vector<LaneGroup> groups;
+
+    CutoffSmoother<float> lowCutSmoother, highCutSmoother;
+    juce::SmoothedValue<float> inGain{ 1.f }, outGain{ 1.f };
+    juce::HeapBlock<float> inGainRamp, outGainRamp;
+
+    juce::AudioBuffer<float> preShaper, shaped;
+    int numPreShaperSamples = 0;
+
+    DistTypes distType{ DistTypes::ArcTan };
+    AccuracyTiers accuracyTier{ AccuracyTiers::StandardTier };
+    bool lowCutBypassed{ false }, highCutBypassed{ false }, distortionBypassed{ false };
+    bool meteringEnabled{ false }, preShaperCaptureEnabled{ false };
+
+    ChainProfiler* profiler = nullptr;
+};
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    WaveShapers.cpp
+
+  ==============================================================================
+*/
+
+#include "WaveShapers.h"
+#include <numbers>
+#include <cmath>
+#include <algorithm>
+
+float arcTanFunc(float x)
+{
+    return atan(x * std::numbers::pi_v<float> / 2) * 2 / std::numbers::pi_v<float>;
+}
+
+float hypTanFunc(float x)
+{
+    return std::tanh(x);
+}
+
+float cubicFunc(float x)
+{
+    float temp;
+    if (x >= 1) temp = 2.f / 3;
+    else if (x <= -1) temp = -2.f / 3;
+    else temp = x - (std::pow(x, 3) / 3);
+    return temp;
+}
+
+float pow5Func(float x)
+{
+    float temp;
+    if (x >= 1) temp = 11.f / 15;
+    else if (x <= -1) temp = -11.f / 15;
+    else temp = x - (std::pow(x, 3) / 6) - (std::pow(x, 5) / 10);
+    return temp;
+}
+
+float pow7Func(float x)
+{
+    float temp;
+    if (x >= 1) temp = 19.f / 24;
+    else if (x <= -1) temp = -19.f / 24;
+    else temp = x - (std::pow(x, 3) / 12) - (std::pow(x, 5) / 16) - (std::pow(x, 7) / 16);
+    return temp;
+}
+
+float hardFunc(float x)
+{
+    float temp = x;
+    if (temp >= 1) temp = 1.f;
+    else if (temp <= -1) temp = -1.f;
+    return (temp);
+}
+
+//==============================================================================
+float CurveShaper::processSample(float x, DistTypes type) const noexcept
+{
+    switch (type)
+    {
+    case ArcTan: return processSampleAtTier<ArcTan>(x);
+    case HypTan: return processSampleAtTier<HypTan>(x);
+    case Cubic:  return processSampleAs<Cubic, StandardTier>(x);
+    case Pow5:   return processSampleAs<Pow5, StandardTier>(x);
+    case Pow7:   return processSampleAs<Pow7, StandardTier>(x);
+    case Hard:   return processSampleAs<Hard, StandardTier>(x);
+    case Custom: return processSampleAs<Custom, StandardTier>(x);
+    }
+    return x;
+}
+
+void CurveShaper::processSamples(const float* input, float* output, int numSamples) const noexcept
+{
+    shapeSamples(input, output, numSamples);
+}
+
+void CurveShaper::processSamples(const double* input, double* output, int numSamples) const noexcept
+{
+    shapeSamples(input, output, numSamples);
+}
+
+template<typename SampleType>
+void CurveShaper::shapeSamples(const SampleType* input, SampleType* output, int numSamples) const noexcept
+{
+    // One tight loop per curve and tier, so both are switched on once per
+    // block rather than once per sample.
+    switch (distType)
+    {
+    case ArcTan: shapeSamplesAtTier<ArcTan>(input, output, numSamples); break;
+    case HypTan: shapeSamplesAtTier<HypTan>(input, output, numSamples); break;
+    case Cubic:  shapeSamplesAs<Cubic, StandardTier>(input, output, numSamples); break;
+    case Pow5:   shapeSamplesAs<Pow5, StandardTier>(input, output, numSamples); break;
+    case Pow7:   shapeSamplesAs<Pow7, StandardTier>(input, output, numSamples); break;
+    case Hard:   shapeSamplesAs<Hard, StandardTier>(input, output, numSamples); break;
+    case Custom: shapeSamplesAs<Custom, StandardTier>(input, output, numSamples); break;
+    }
+}
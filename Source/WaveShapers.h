@@ -0,0 +1,399 @@
+/*
+  ==============================================================================
+
+    WaveShapers.h
+
+    Transfer curves for the distortion stage, plus the block-based shaper
+    that the processing chain uses in place of juce::dsp::WaveShaper.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <type_traits>
+#include "CustomCurve.h"
+
+enum DistTypes
+{
+    ArcTan,
+    HypTan,
+    Cubic,
+    Pow5,
+    Pow7,
+    Hard,
+    Custom
+};
+
+// Closed-form transfer curves. These are the reference definitions that the
+// shaper below is measured against, and what the editor plots.
+float arcTanFunc(float);
+float hypTanFunc(float);
+float cubicFunc(float);
+float pow5Func(float);
+float pow7Func(float);
+float hardFunc(float);
+
+// How closely ArcTan and HypTan follow their closed forms. The other curves
+// are exact at every tier.
+enum AccuracyTiers
+{
+    DraftTier,
+    StandardTier,
+    ExactTier
+};
+
+//==============================================================================
+/**
+    Waveshaper for the distortion stage.
+
+    ArcTan and HypTan are evaluated at the instance's accuracy tier. Draft
+    and Standard are branch-free approximations: ArcTan is an odd minimax
+    polynomial over [0, 1], with atan(z) = pi/2 - atan(1/z) above that, and
+    HypTan is a minimax rational clamped where it meets 1. Exact calls the
+    maths library in double. Cubic, Pow5, Pow7 and Hard are clamped to
+    [-1, 1] and evaluated as Horner polynomials, which is exact up to float
+    rounding. Custom reads whichever CustomCurveTable it was last given.
+
+    processSampleAs() also takes a SIMDRegister<float>, which is how
+    VectorChain shapes its interleaved lanes. Every curve but Custom and
+    the Exact tier then runs as register code, whatever the compiler makes
+    of the scalar loops. SIMDRegister has no division, so there 1 / d is a
+    reciprocal estimate refined by Newton steps, a few ulp out.
+
+    Double samples are shaped in double throughout with the same
+    coefficients.
+
+    Maximum absolute error against the closed-form curves, measured over
+    [-40, 40], in float (double where it differs; register where it
+    differs from float):
+                Draft      Standard                      Exact
+        ArcTan  4.5e-4     2.8e-7 (1.7e-7)               3.0e-8 (0)
+        HypTan  4.8e-5     3.4e-7 (1.9e-8; 4.1e-7)       3.0e-8 (0)
+        Cubic   6.0e-8
+        Pow5    1.2e-7
+        Pow7    6.0e-8
+        Hard    0
+
+    Cost in float, in ns per sample over 4096-sample blocks (one Xeon
+    core, g++ -O3 with SSE2 only), scalar loop / SSE register:
+                Draft       Standard    Exact
+        ArcTan  1.6 / 1.5   2.2 / 2.4   14 / 13
+        HypTan  3.9 / 1.4   5.0 / 1.6   20 / 20
+        Cubic               1.7 / 0.5
+        Pow5                1.7 / 0.6
+        Pow7                1.8 / 0.6
+        Hard                0.7 / 0.3
+    GCC vectorises the scalar ArcTan loop itself, but leaves the clamped
+    curves scalar under its default -ftrapping-math.
+*/
+struct CurveShaper
+{
+    void prepare(const juce::dsp::ProcessSpec&) noexcept {}
+    void reset() noexcept {}
+
+    void setDistType(DistTypes newType) noexcept { distType = newType; }
+    DistTypes getDistType() const noexcept { return distType; }
+
+    void setAccuracyTier(AccuracyTiers newTier) noexcept { accuracyTier = newTier; }
+    AccuracyTiers getAccuracyTier() const noexcept { return accuracyTier; }
+
+    // Whether the tier makes any difference to a curve.
+    static constexpr bool hasAccuracyTiers(DistTypes type) noexcept { return type == DistTypes::ArcTan || type == DistTypes::HypTan; }
+
+    // The table must outlive its use here; CustomCurveSlot sees to that.
+    void setCustomCurve(const CustomCurveTable* newCurve) noexcept { customCurve = newCurve; }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        auto&& inBlock = context.getInputBlock();
+        auto&& outBlock = context.getOutputBlock();
+
+        jassert(inBlock.getNumChannels() == outBlock.getNumChannels());
+        jassert(inBlock.getNumSamples() == outBlock.getNumSamples());
+
+        if (context.isBypassed)
+        {
+            if (context.usesSeparateInputAndOutputBlocks())
+                outBlock.copyFrom(inBlock);
+            return;
+        }
+
+        for (size_t ch = 0; ch < inBlock.getNumChannels(); ++ch)
+            processSamples(inBlock.getChannelPointer(ch),
+                outBlock.getChannelPointer(ch),
+                static_cast<int>(inBlock.getNumSamples()));
+    }
+
+    void processSamples(const float* input, float* output, int numSamples) const noexcept;
+    void processSamples(const double* input, double* output, int numSamples) const noexcept;
+    float processSample(float x) const noexcept { return processSample(x, distType); }
+
+    // Through any curve, whatever the shaper's own type is, at the
+    // shaper's own tier.
+    float processSample(float x, DistTypes type) const noexcept;
+
+    // One sample through a curve and tier fixed at compile time, for
+    // callers that pick a loop per curve once per block and want it
+    // inlined. SampleType may also be SIMDRegister<float>, to shape a
+    // register of lanes at once.
+    template<DistTypes type, AccuracyTiers tier, typename SampleType>
+    SampleType processSampleAs(SampleType x) const noexcept
+    {
+        using Element = typename juce::dsp::SampleTypeHelpers::ElementType<SampleType>::Type;
+
+        if constexpr (isRegister<SampleType> && (type == DistTypes::Custom || (hasAccuracyTiers(type) && tier == AccuracyTiers::ExactTier)))
+        {
+            // These have no register form, so they go lane by lane.
+            alignas(SampleType::SIMDRegisterSize) Element lanes[SampleType::size()];
+            x.copyToRawArray(lanes);
+
+            for (auto& lane : lanes)
+                lane = processSampleAs<type, tier>(lane);
+
+            return SampleType::fromRawArray(lanes);
+        }
+        else if constexpr (type == DistTypes::ArcTan)
+        {
+            if constexpr (tier == AccuracyTiers::ExactTier)
+                return static_cast<SampleType>(std::atan(static_cast<double>(x) * std::numbers::pi / 2) * 2 / std::numbers::pi);
+            else
+                return arcTanApprox<tier>(x);
+        }
+        else if constexpr (type == DistTypes::HypTan)
+        {
+            if constexpr (tier == AccuracyTiers::ExactTier)
+                return static_cast<SampleType>(std::tanh(static_cast<double>(x)));
+            else
+                return hypTanApprox<tier>(x);
+        }
+        else if constexpr (type == DistTypes::Cubic)
+        {
+            x = clamp(x, Element(1));
+            auto x2 = x * x;
+            return x * (x2 * (Element(-1) / 3) + Element(1));
+        }
+        else if constexpr (type == DistTypes::Pow5)
+        {
+            x = clamp(x, Element(1));
+            auto x2 = x * x;
+            return x * (x2 * (x2 * (Element(-1) / 10) + Element(-1) / 6) + Element(1));
+        }
+        else if constexpr (type == DistTypes::Pow7)
+        {
+            x = clamp(x, Element(1));
+            auto x2 = x * x;
+            return x * (x2 * (x2 * (x2 * (Element(-1) / 16) + Element(-1) / 16) + Element(-1) / 12) + Element(1));
+        }
+        else if constexpr (type == DistTypes::Custom)
+        {
+            return customCurve->processSample(x);
+        }
+        else
+        {
+            return clamp(x, Element(1));
+        }
+    }
+
+private:
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    template<typename SampleType>
+    static constexpr bool isRegister = std::is_same_v<SampleType, Vec>;
+
+    // The few operations below that SIMDRegister spells differently. Scalars
+    // keep the plain forms, so their results don't depend on the build.
+    template<typename SampleType>
+    static SampleType minimum(SampleType a, SampleType b) noexcept
+    {
+        if constexpr (isRegister<SampleType>)
+            return SampleType::min(a, b);
+        else
+            return std::min(a, b);
+    }
+
+    template<typename SampleType>
+    static SampleType maximum(SampleType a, SampleType b) noexcept
+    {
+        if constexpr (isRegister<SampleType>)
+            return SampleType::max(a, b);
+        else
+            return std::max(a, b);
+    }
+
+    // On registers, both work on the float sign bit.
+    template<typename SampleType>
+    static SampleType absolute(SampleType x) noexcept
+    {
+        if constexpr (isRegister<SampleType>)
+            return x & 0x7fffffffu;
+        else
+            return std::abs(x);
+    }
+
+    // magnitude, which must not be negative, with the sign of sign.
+    template<typename SampleType>
+    static SampleType copySign(SampleType magnitude, SampleType sign) noexcept
+    {
+        if constexpr (isRegister<SampleType>)
+            return magnitude * ((sign & 0x80000000u) | 0x3f800000u);
+        else
+            return std::copysign(magnitude, sign);
+    }
+
+    // There is no register division. A reciprocal estimate refined by
+    // Newton steps gets within a few ulp of 1 / d, for d of at least 1e-30
+    // (smaller d are taken as 1e-30).
+    template<typename SampleType>
+    static SampleType divide(SampleType n, SampleType d) noexcept
+    {
+        if constexpr (isRegister<SampleType>)
+        {
+            d = SampleType::max(d, SampleType(1.0e-30f));
+
+           #if JUCE_USE_SSE_INTRINSICS
+            SampleType r;
+            if constexpr (SampleType::size() == 4)
+                r = SampleType::fromNative(_mm_rcp_ps(d.value));
+            else
+                r = SampleType::fromNative(_mm256_rcp_ps(d.value));
+
+            // 12 bits from the estimate, about 22 after one step.
+            r = r * (SampleType(2.f) - d * r);
+           #elif JUCE_USE_ARM_NEON
+            auto r = SampleType::fromNative(vrecpeq_f32(d.value));
+
+            // 8 bits from the estimate, so it takes two.
+            r = r * SampleType::fromNative(vrecpsq_f32(d.value, r.value));
+            r = r * SampleType::fromNative(vrecpsq_f32(d.value, r.value));
+           #else
+            SampleType r;
+            for (size_t lane = 0; lane < SampleType::size(); ++lane)
+                r.set(lane, 1.f / d.get(lane));
+           #endif
+
+            return n * r;
+        }
+        else
+        {
+            return n / d;
+        }
+    }
+
+    // (2/pi) atan(pi/2 x). With z = |pi/2 x| and t = min(z, 1/z), the
+    // polynomial covers atan(t) on [0, 1], and pi/2 minus it covers z > 1.
+    // The side is picked by sign rather than by branch, since a select
+    // feeding the division keeps GCC from vectorising the scalar loop.
+    // Minimax odd polynomials, 3 terms for Draft and 7 for Standard, pinned
+    // to pi/4 at t = 1 so the two sides meet with matching slope.
+    template<AccuracyTiers tier, typename SampleType>
+    static SampleType arcTanApprox(SampleType x) noexcept
+    {
+        using Element = typename juce::dsp::SampleTypeHelpers::ElementType<SampleType>::Type;
+        constexpr auto halfPi = std::numbers::pi_v<Element> / 2;
+        constexpr auto quarterPi = std::numbers::pi_v<Element> / 4;
+
+        auto z = absolute(x) * halfPi;
+        auto t = minimum(z, divide(SampleType(Element(1)), z));
+        auto t2 = t * t;
+
+        SampleType p;
+        if constexpr (tier == AccuracyTiers::DraftTier)
+        {
+            p = t * (t2 * (t2 * Element(0.076066318630534147) + Element(-0.28543420211672516))
+                + Element(0.99476604688363923));
+        }
+        else
+        {
+            p = t * (t2 * (t2 * (t2 * (t2 * (t2 * (t2 * Element(0.0066625212869089179)
+                + Element(-0.033159454837019549)) + Element(0.079118790395880045))
+                + Element(-0.1320615109521483)) + Element(0.19800800658389828))
+                + Element(-0.33316607075262811)) + Element(0.99999588167255704));
+        }
+
+        auto side = copySign(SampleType(Element(1)), SampleType(Element(1)) - z);
+        auto y = side * (p - quarterPi) + quarterPi;
+        return copySign(y * (1 / halfPi), x);
+    }
+
+    // tanh(x) as an odd over even minimax rational on [0, clip], where tanh
+    // is within the tier's error of 1: degree 5/4 up to 5 for Draft, 9/8 up
+    // to 9 for Standard. The clamp on the way out catches the last ulp.
+    template<AccuracyTiers tier, typename SampleType>
+    static SampleType hypTanApprox(SampleType x) noexcept
+    {
+        using Element = typename juce::dsp::SampleTypeHelpers::ElementType<SampleType>::Type;
+        SampleType numerator, denominator;
+
+        if constexpr (tier == AccuracyTiers::DraftTier)
+        {
+            x = clamp(x, Element(5));
+            auto x2 = x * x;
+            numerator = x * (x2 * (x2 * Element(0.00065494469157633946) + Element(0.1017231705511952))
+                + Element(0.99981014423235692));
+            denominator = x2 * (x2 * Element(0.012639189550039355) + Element(0.43450409950905189)) + Element(1);
+        }
+        else
+        {
+            x = clamp(x, Element(9));
+            auto x2 = x * x;
+            numerator = x * (x2 * (x2 * (x2 * (x2 * Element(1.3184219108953905e-08) + Element(2.0471826067145563e-05))
+                + Element(0.0034865815620140992)) + Element(0.13373197393089511)) + Element(0.99999990634694613));
+            denominator = x2 * (x2 * (x2 * (x2 * Element(7.7026612612420299e-07) + Element(0.00032713848904652499))
+                + Element(0.025841977858654153)) + Element(0.46706494254976033)) + Element(1);
+        }
+
+        return clamp(divide(numerator, denominator), Element(1));
+    }
+
+    // To [-limit, limit], written as max then min rather than std::clamp,
+    // which compilers can keep as a branch.
+    template<typename SampleType, typename Element>
+    static SampleType clamp(SampleType x, Element limit) noexcept
+    {
+        return minimum(maximum(x, SampleType(-limit)), SampleType(limit));
+    }
+
+    template<DistTypes type, AccuracyTiers tier, typename SampleType>
+    void shapeSamplesAs(const SampleType* input, SampleType* output, int numSamples) const noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            output[i] = processSampleAs<type, tier>(input[i]);
+    }
+
+    // Switches on the tier once, for the curves that have tiers.
+    template<DistTypes type, typename SampleType>
+    void shapeSamplesAtTier(const SampleType* input, SampleType* output, int numSamples) const noexcept
+    {
+        switch (accuracyTier)
+        {
+        case DraftTier:    shapeSamplesAs<type, DraftTier>(input, output, numSamples); break;
+        case StandardTier: shapeSamplesAs<type, StandardTier>(input, output, numSamples); break;
+        case ExactTier:    shapeSamplesAs<type, ExactTier>(input, output, numSamples); break;
+        }
+    }
+
+    template<DistTypes type>
+    float processSampleAtTier(float x) const noexcept
+    {
+        switch (accuracyTier)
+        {
+        case DraftTier:    return processSampleAs<type, DraftTier>(x);
+        case StandardTier: return processSampleAs<type, StandardTier>(x);
+        case ExactTier:    return processSampleAs<type, ExactTier>(x);
+        }
+        return x;
+    }
+
+    template<typename SampleType>
+    void shapeSamples(const SampleType* input, SampleType* output, int numSamples) const noexcept;
+
+    DistTypes distType{ DistTypes::ArcTan };
+    AccuracyTiers accuracyTier{ AccuracyTiers::StandardTier };
+    const CustomCurveTable* customCurve = &CustomCurveTable::getDefault();
+};
@@ -0,0 +1,498 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Micro-benchmarks for MonoChain and the full processBlock, across every
+    DistTypes value, block size, sample rate and bypass combination, in
+    float and double.
+
+    With --stress, runs the stress test in StressTest.cpp instead.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "StressTest.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+    enum Targets
+    {
+        MonoChainTarget,
+        ProcessBlockTarget
+    };
+
+    struct BenchmarkCase
+    {
+        Targets target;
+        DistTypes distType;
+        int blockSize;
+        double sampleRate;
+        bool lowCutBypassed, highCutBypassed, distortionBypassed;
+        FilterSlopes slope;
+        AccuracyTiers accuracyTier;
+        bool doublePrecision;
+
+        juce::String getName() const
+        {
+            static const char* targetNames[] = { "MonoChain", "processBlock" };
+            static const char* distNames[] = { "ArcTan", "HypTan", "Cubic", "Pow5", "Pow7", "Hard", "Custom" };
+            static const char* tierNames[] = { "draft", "standard", "exact" };
+
+            // Active stages are listed, so "none" means everything is bypassed.
+            juce::StringArray active;
+            if (! lowCutBypassed) active.add("lowcut");
+            if (! distortionBypassed) active.add("dist");
+            if (! highCutBypassed) active.add("highcut");
+
+            // The default slope and tier are left out so names match older
+            // reports.
+            auto name = juce::String(targetNames[target]) + "/" + distNames[distType] + "/"
+                + juce::String(blockSize) + "/" + juce::String(juce::roundToInt(sampleRate)) + "/"
+                + (active.isEmpty() ? juce::String("none") : active.joinIntoString("+"));
+
+            if (slope != FilterSlopes::Slope6)
+                name << "/" << 6 * (slope + 1) << "dB";
+            if (accuracyTier != AccuracyTiers::StandardTier)
+                name << "/" << tierNames[accuracyTier];
+            if (doublePrecision)
+                name << "/double";
+
+            return name;
+        }
+    };
+
+    struct Statistics
+    {
+        double median = 0, min = 0, p90 = 0;
+    };
+
+    struct BenchmarkOptions
+    {
+        std::vector<int> blockSizes{ 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192 };
+        std::vector<double> sampleRates{ 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+        juce::String filter;
+        juce::File outputFile{ juce::File::getCurrentWorkingDirectory().getChildFile("benchmark.json") };
+        juce::File baselineFile;
+        int repetitions = 21;
+        int samplesPerRepetition = 1 << 15;
+        FilterSlopes slope = FilterSlopes::Slope6;
+        AccuracyTiers accuracyTier = AccuracyTiers::StandardTier;
+        std::vector<bool> precisions{ false };
+        int subBlockSize = TestDistortionAudioProcessor::defaultSubBlockSize;
+        bool useReferencePath = false;
+        bool metering = false;
+        bool stress = false;
+        StressOptions stressOptions{ juce::Time::currentTimeMillis() };
+    };
+
+    // Settings every case starts from; the case then picks the curve and
+    // bypass states. The gains drive the shaper well into its curve.
+    ChainSettings getBaseSettings(const BenchmarkCase& c)
+    {
+        ChainSettings settings;
+        settings.lowFreq = 80.f;
+        settings.highFreq = 12000.f;
+        settings.lowCutSlope = c.slope;
+        settings.highCutSlope = c.slope;
+        settings.inGain = 12.f;
+        settings.outGain = -6.f;
+        settings.distType = c.distType;
+        settings.accuracyTier = c.accuracyTier;
+        settings.lowCutBypassed = c.lowCutBypassed;
+        settings.highCutBypassed = c.highCutBypassed;
+        settings.distortionBypassed = c.distortionBypassed;
+        return settings;
+    }
+
+    template<typename SampleType>
+    void configureMonoChain(MonoChain<SampleType>& chain, const ChainSettings& settings, bool metering)
+    {
+        chain.template get<ChainPositions::LowCut>().setCutoffFrequency(settings.lowFreq);
+        chain.template get<ChainPositions::HighCut>().setCutoffFrequency(settings.highFreq);
+        chain.template get<ChainPositions::LowCut>().setSlope(settings.lowCutSlope);
+        chain.template get<ChainPositions::HighCut>().setSlope(settings.highCutSlope);
+        chain.template get<ChainPositions::GainIn>().setGainDecibels(settings.inGain);
+        chain.template get<ChainPositions::GainOut>().setGainDecibels(settings.outGain);
+        chain.template get<ChainPositions::WaveShape>().setDistType(settings.distType);
+        chain.template get<ChainPositions::WaveShape>().setAccuracyTier(settings.accuracyTier);
+
+        chain.template setBypassed<ChainPositions::LowCut>(settings.lowCutBypassed);
+        chain.template setBypassed<ChainPositions::HighCut>(settings.highCutBypassed);
+        chain.template setBypassed<ChainPositions::WaveShape>(settings.distortionBypassed);
+
+        // As processBlock runs it: no sample capture, and meters only when
+        // asked for.
+        chain.template setBypassed<ChainPositions::FifoBlk>(true);
+        chain.template setBypassed<ChainPositions::PreMeter>(! metering);
+        chain.template setBypassed<ChainPositions::PostMeter>(! metering);
+
+        chain.reset();
+    }
+
+    void setParameter(juce::AudioProcessorValueTreeState& apvts, const juce::String& id, float value)
+    {
+        auto* parameter = apvts.getParameter(id);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    void configureProcessor(TestDistortionAudioProcessor& processor, const ChainSettings& settings)
+    {
+        auto& apvts = processor.apvts;
+        setParameter(apvts, "LowCut Freq", settings.lowFreq);
+        setParameter(apvts, "HighCut Freq", settings.highFreq);
+        setParameter(apvts, "LowCut Slope", static_cast<float>(settings.lowCutSlope));
+        setParameter(apvts, "HighCut Slope", static_cast<float>(settings.highCutSlope));
+        setParameter(apvts, "Input Gain", settings.inGain);
+        setParameter(apvts, "Output Gain", settings.outGain);
+        setParameter(apvts, "Distortion Type", static_cast<float>(settings.distType));
+        setParameter(apvts, "Curve Accuracy", static_cast<float>(settings.accuracyTier));
+        setParameter(apvts, "LowCut Bypassed", settings.lowCutBypassed ? 1.f : 0.f);
+        setParameter(apvts, "HighCut Bypassed", settings.highCutBypassed ? 1.f : 0.f);
+        setParameter(apvts, "Distortion Bypassed", settings.distortionBypassed ? 1.f : 0.f);
+    }
+
+    // A few detuned partials with noise, so no stage sees a constant input.
+    // The same float values go into both precisions.
+    template<typename SampleType>
+    void fillTestSignal(juce::AudioBuffer<SampleType>& buffer, double sampleRate)
+    {
+        juce::Random random(0x5eed);
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            auto* data = buffer.getWritePointer(ch);
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                auto t = i / sampleRate;
+                auto value = 0.4f * std::sin(static_cast<float>(juce::MathConstants<double>::twoPi * 110.0 * t))
+                           + 0.2f * std::sin(static_cast<float>(juce::MathConstants<double>::twoPi * 1730.0 * t + ch))
+                           + 0.05f * (random.nextFloat() * 2.f - 1.f);
+                data[i] = static_cast<SampleType>(value);
+            }
+        }
+    }
+
+    Statistics getStatistics(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+
+        Statistics stats;
+        stats.min = values.front();
+        stats.median = values[values.size() / 2];
+        stats.p90 = values[std::min(values.size() - 1, static_cast<size_t>(0.9 * static_cast<double>(values.size())))];
+        return stats;
+    }
+
+    // Times repetitions of processing the whole source buffer in blockSize
+    // chunks, after two warm-up repetitions. The source is copied into the
+    // work buffer before each repetition, outside the timed region, so every
+    // repetition sees the same input and the clock is read only twice.
+    template<typename SampleType, typename ProcessFn>
+    Statistics timeCase(const BenchmarkOptions& options, const juce::AudioBuffer<SampleType>& source,
+                        juce::AudioBuffer<SampleType>& work, int blockSize, ProcessFn&& process)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        auto numChannels = work.getNumChannels();
+        auto numBlocks = source.getNumSamples() / blockSize;
+        std::vector<double> nsPerSample;
+
+        for (int rep = -2; rep < options.repetitions; ++rep)
+        {
+            work.makeCopyOf(source, true);
+            auto start = Clock::now();
+
+            for (int b = 0; b < numBlocks; ++b)
+            {
+                juce::AudioBuffer<SampleType> view(work.getArrayOfWritePointers(), numChannels, b * blockSize, blockSize);
+                process(view);
+            }
+
+            auto elapsed = Clock::now() - start;
+
+            if (rep >= 0)
+                nsPerSample.push_back(std::chrono::duration<double, std::nano>(elapsed).count()
+                    / (static_cast<double>(numBlocks) * blockSize * numChannels));
+        }
+
+        return getStatistics(std::move(nsPerSample));
+    }
+
+    std::vector<BenchmarkCase> makeCases(const BenchmarkOptions& options)
+    {
+        std::vector<BenchmarkCase> cases;
+
+        for (auto doublePrecision : options.precisions)
+            for (auto target : { Targets::MonoChainTarget, Targets::ProcessBlockTarget })
+                for (auto sampleRate : options.sampleRates)
+                    for (auto blockSize : options.blockSizes)
+                        for (int distType = DistTypes::ArcTan; distType <= DistTypes::Custom; ++distType)
+                            for (int bypass = 0; bypass < 8; ++bypass)
+                            {
+                                BenchmarkCase c{ target, static_cast<DistTypes>(distType), blockSize, sampleRate,
+                                                 (bypass & 1) != 0, (bypass & 2) != 0, (bypass & 4) != 0, options.slope,
+                                                 options.accuracyTier, doublePrecision };
+
+                                if (options.filter.isEmpty() || c.getName().contains(options.filter))
+                                    cases.push_back(c);
+                            }
+
+        return cases;
+    }
+
+    juce::var toJson(const BenchmarkCase& c, const Statistics& stats)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("name", c.getName());
+        object->setProperty("target", c.target == Targets::MonoChainTarget ? "MonoChain" : "processBlock");
+        object->setProperty("distType", static_cast<int>(c.distType));
+        object->setProperty("blockSize", c.blockSize);
+        object->setProperty("sampleRate", c.sampleRate);
+        object->setProperty("lowCutBypassed", c.lowCutBypassed);
+        object->setProperty("highCutBypassed", c.highCutBypassed);
+        object->setProperty("distortionBypassed", c.distortionBypassed);
+        object->setProperty("slopeDbPerOctave", 6 * (c.slope + 1));
+        object->setProperty("accuracyTier", static_cast<int>(c.accuracyTier));
+        object->setProperty("precision", c.doublePrecision ? "double" : "float");
+        object->setProperty("medianNsPerSample", stats.median);
+        object->setProperty("minNsPerSample", stats.min);
+        object->setProperty("p90NsPerSample", stats.p90);
+        return juce::var(object);
+    }
+
+    // Prints the median change for every case that is in both reports.
+    void compareWithBaseline(const juce::File& baselineFile, const juce::Array<juce::var>& results)
+    {
+        auto baseline = juce::JSON::parse(baselineFile);
+        auto* baselineCases = baseline["cases"].getArray();
+        if (baselineCases == nullptr)
+        {
+            std::cerr << "Could not read baseline " << baselineFile.getFullPathName() << std::endl;
+            return;
+        }
+
+        std::map<juce::String, double> baselineMedians;
+        for (auto& c : *baselineCases)
+            baselineMedians[c["name"].toString()] = static_cast<double>(c["medianNsPerSample"]);
+
+        std::cout << "\nChange in median against " << baselineFile.getFileName() << ":\n";
+        for (auto& result : results)
+        {
+            auto it = baselineMedians.find(result["name"].toString());
+            if (it == baselineMedians.end() || it->second <= 0)
+                continue;
+
+            auto change = 100.0 * (static_cast<double>(result["medianNsPerSample"]) / it->second - 1.0);
+            std::cout << "  " << result["name"].toString().paddedRight(' ', 52)
+                      << (change >= 0 ? "+" : "") << juce::String(change, 1) << "%\n";
+        }
+        std::cout << std::flush;
+    }
+
+    bool parseArguments(const juce::ArgumentList& args, BenchmarkOptions& options)
+    {
+        auto parseList = [](const juce::String& text)
+        {
+            return juce::StringArray::fromTokens(text, ",", {});
+        };
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            auto arg = args[i].text;
+            auto hasValue = i + 1 < args.size();
+
+            if (arg == "--output" && hasValue)
+                options.outputFile = args[++i].resolveAsFile();
+            else if (arg == "--baseline" && hasValue)
+                options.baselineFile = args[++i].resolveAsFile();
+            else if (arg == "--filter" && hasValue)
+                options.filter = args[++i].text;
+            else if (arg == "--repetitions" && hasValue)
+                options.repetitions = juce::jmax(1, args[++i].text.getIntValue());
+            else if (arg == "--block-sizes" && hasValue)
+            {
+                options.blockSizes.clear();
+                for (auto& token : parseList(args[++i].text))
+                    options.blockSizes.push_back(juce::jmax(1, token.getIntValue()));
+            }
+            else if (arg == "--sample-rates" && hasValue)
+            {
+                options.sampleRates.clear();
+                for (auto& token : parseList(args[++i].text))
+                    options.sampleRates.push_back(token.getDoubleValue());
+            }
+            else if (arg == "--slope" && hasValue)
+                options.slope = static_cast<FilterSlopes>(juce::jlimit(0, static_cast<int>(FilterSlopes::Slope48),
+                                                                       args[++i].text.getIntValue() / 6 - 1));
+            else if (arg == "--accuracy" && hasValue && juce::StringArray{ "draft", "standard", "exact" }.contains(args[i + 1].text))
+            {
+                auto tier = juce::StringArray{ "draft", "standard", "exact" }.indexOf(args[++i].text);
+                options.accuracyTier = static_cast<AccuracyTiers>(tier);
+            }
+            else if (arg == "--precision" && hasValue && juce::StringArray{ "float", "double", "both" }.contains(args[i + 1].text))
+            {
+                auto precision = args[++i].text;
+                options.precisions.clear();
+                if (precision != "double")
+                    options.precisions.push_back(false);
+                if (precision != "float")
+                    options.precisions.push_back(true);
+            }
+            else if (arg == "--sub-block" && hasValue)
+                options.subBlockSize = args[++i].text.getIntValue();
+            else if (arg == "--reference")
+                options.useReferencePath = true;
+            else if (arg == "--meters")
+                options.metering = true;
+            else if (arg == "--stress")
+                options.stress = true;
+            else if (arg == "--seed" && hasValue)
+                options.stressOptions.seed = args[++i].text.getLargeIntValue();
+            else if (arg == "--blocks" && hasValue)
+                options.stressOptions.numBlocks = juce::jmax(1, args[++i].text.getIntValue());
+            else if (arg == "--max-load" && hasValue)
+                options.stressOptions.maxLoad = juce::jmax(0.0, args[++i].text.getDoubleValue());
+            else
+            {
+                std::cout << "Usage: Benchmark [options]\n"
+                             "\n"
+                             "  --output <file>         JSON report (default: benchmark.json)\n"
+                             "  --baseline <file>       Earlier report to compare medians against\n"
+                             "  --filter <text>         Only run cases whose name contains <text>,\n"
+                             "                          e.g. \"processBlock/Hard/512\"\n"
+                             "  --repetitions <n>       Timed repetitions per case (default 21)\n"
+                             "  --block-sizes <list>    Comma-separated (default 16 to 8192)\n"
+                             "  --sample-rates <list>   Comma-separated (default 44100 to 192000)\n"
+                             "  --slope <dB/oct>        Slope of both cut filters, 6 to 48 (default 6)\n"
+                             "  --accuracy <tier>       ArcTan and HypTan tier: draft, standard or exact\n"
+                             "                          (default standard)\n"
+                             "  --precision <p>         float, double or both (default float)\n"
+                             "  --sub-block <n>         processBlock's internal sub-block size (default 128)\n"
+                             "  --reference             Run processBlock on the per-channel reference path\n"
+                             "  --meters                Include the level meters, as with the editor open\n"
+                             "\n"
+                             "  --stress                Stress-test processBlock instead of timing it\n"
+                             "  --seed <n>              Seed for --stress (default: the time, printed)\n"
+                             "  --blocks <n>            Blocks to run with --stress (default 20000)\n"
+                             "  --max-load <x>          List blocks over this share of their duration\n"
+                             "                          (default 1.0)\n"
+                          << std::endl;
+                return false;
+            }
+        }
+
+        return ! options.blockSizes.empty() && ! options.sampleRates.empty();
+    }
+
+    template<typename SampleType>
+    Statistics runCase(const BenchmarkOptions& options, const BenchmarkCase& c,
+                       TestDistortionAudioProcessor& processor, MonoChain<SampleType>& chain)
+    {
+        auto settings = getBaseSettings(c);
+        auto numChannels = c.target == Targets::MonoChainTarget ? 1 : 2;
+
+        auto numBlocks = juce::jmax(1, options.samplesPerRepetition / c.blockSize);
+        juce::AudioBuffer<SampleType> source(numChannels, numBlocks * c.blockSize);
+        juce::AudioBuffer<SampleType> work(source);
+        fillTestSignal(source, c.sampleRate);
+
+        if (c.target == Targets::MonoChainTarget)
+        {
+            chain.prepare({ c.sampleRate, static_cast<juce::uint32>(c.blockSize), 1 });
+            configureMonoChain(chain, settings, options.metering);
+
+            return timeCase(options, source, work, c.blockSize, [&](juce::AudioBuffer<SampleType>& buffer)
+            {
+                juce::dsp::AudioBlock<SampleType> block(buffer);
+                chain.process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+            });
+        }
+
+        juce::MidiBuffer midi;
+        configureProcessor(processor, settings);
+        processor.setProcessingPrecision(std::is_same_v<SampleType, double> ? juce::AudioProcessor::doublePrecision
+                                                                            : juce::AudioProcessor::singlePrecision);
+        processor.setRateAndBufferSizeDetails(c.sampleRate, c.blockSize);
+        processor.prepareToPlay(c.sampleRate, c.blockSize);
+
+        auto stats = timeCase(options, source, work, c.blockSize, [&](juce::AudioBuffer<SampleType>& buffer)
+        {
+            processor.processBlock(buffer, midi);
+        });
+
+        processor.releaseResources();
+        return stats;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    BenchmarkOptions options;
+    if (! parseArguments(juce::ArgumentList(argc, argv), options))
+        return 1;
+
+    if (options.stress)
+        return runStressTest(options.stressOptions) > 0 ? 1 : 0;
+
+    auto cases = makeCases(options);
+    std::cout << "Running " << cases.size() << " cases, "
+              << options.repetitions << " repetitions of " << options.samplesPerRepetition
+              << " samples each. Figures are ns per sample per channel." << std::endl;
+
+    juce::Array<juce::var> results;
+    TestDistortionAudioProcessor processor;
+    processor.setProcessingPath(options.useReferencePath ? ProcessingPaths::ReferencePath
+                                                         : ProcessingPaths::VectorPath);
+    processor.setVisualisationMode(options.metering ? VisualisationModes::MetersOnly
+                                                    : VisualisationModes::NoVisualisation);
+    processor.setSubBlockSize(options.subBlockSize);
+    MonoChain<float> chain;
+    MonoChain<double> doubleChain;
+
+    for (auto& c : cases)
+    {
+        auto stats = c.doublePrecision ? runCase(options, c, processor, doubleChain)
+                                       : runCase(options, c, processor, chain);
+
+        std::cout << c.getName().paddedRight(' ', 52)
+                  << " median " << juce::String(stats.median, 3).paddedLeft(' ', 8)
+                  << "  min " << juce::String(stats.min, 3).paddedLeft(' ', 8)
+                  << "  p90 " << juce::String(stats.p90, 3).paddedLeft(' ', 8) << std::endl;
+
+        results.add(toJson(c, stats));
+    }
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty("processingPath", options.useReferencePath ? "reference" : "vector");
+    report->setProperty("metering", options.metering);
+    report->setProperty("subBlockSize", processor.getSubBlockSize());
+    report->setProperty("repetitions", options.repetitions);
+    report->setProperty("samplesPerRepetition", options.samplesPerRepetition);
+    report->setProperty("cpu", juce::SystemStats::getCpuModel());
+    report->setProperty("cases", results);
+
+    if (! options.outputFile.replaceWithText(juce::JSON::toString(juce::var(report))))
+    {
+        std::cerr << "Could not write " << options.outputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+    std::cout << "\nWrote " << options.outputFile.getFullPathName() << std::endl;
+
+    if (options.baselineFile != juce::File())
+        compareWithBaseline(options.baselineFile, results);
+
+    return 0;
+}
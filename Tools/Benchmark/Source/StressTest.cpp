@@ -0,0 +1,417 @@
+/*
+  ==============================================================================
+
+    StressTest.cpp
+
+  ==============================================================================
+*/
+
+#include "StressTest.h"
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/AllocationTracker.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <thread>
+
+namespace
+{
+    constexpr int maxBlockSize = 16384;
+    constexpr int maxChannels = 6;
+
+    // Samples either side of every channel, and one whole channel past the
+    // last, are set to guardValue and must come back untouched.
+    constexpr int guardSamples = 64;
+    constexpr float guardValue = 1234.5f;
+
+    // Blocks straight after prepareToPlay run on cold caches, so they are
+    // left out of the timing.
+    constexpr int warmUpBlocks = 2;
+
+    constexpr int maxPrintedBlocks = 20;
+
+    // What the host is doing at the moment; printed with every failure.
+    struct HostState
+    {
+        double sampleRate = 44100.0;
+        int announcedBlockSize = 512;
+        int numChannels = 2;
+        int subBlockSize = TestDistortionAudioProcessor::defaultSubBlockSize;
+        bool doublePrecision = false;
+        ProcessingPaths path = ProcessingPaths::VectorPath;
+        VisualisationModes visualisation = VisualisationModes::NoVisualisation;
+
+        juce::String describe() const
+        {
+            return juce::String(juce::roundToInt(sampleRate)) + " Hz, " + juce::String(numChannels) + " ch, "
+                 + (doublePrecision ? "double, " : "float, ")
+                 + (path == ProcessingPaths::VectorPath ? "vector, " : "reference, ")
+                 + (visualisation == VisualisationModes::NoVisualisation ? "" : "meters, ")
+                 + "prepared for " + juce::String(announcedBlockSize)
+                 + ", sub-block " + juce::String(subBlockSize);
+        }
+    };
+
+    struct BlockResult
+    {
+        juce::String failure;
+        double seconds = 0;
+        juce::int64 allocations = 0;
+    };
+
+    // Mostly log-uniform from 1 to maxBlockSize, with the odd empty block.
+    int getRandomBlockSize(juce::Random& random)
+    {
+        if (random.nextInt(20) == 0)
+            return 0;
+        if (random.nextInt(50) == 0)
+            return maxBlockSize;
+
+        return juce::jlimit(1, maxBlockSize, static_cast<int>(std::exp2(random.nextDouble() * std::log2(maxBlockSize))));
+    }
+
+    HostState makeRandomHostState(juce::Random& random)
+    {
+        static const double sampleRates[] = { 22050.0, 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+        static const int channelCounts[] = { 1, 2, maxChannels };
+        static const int subBlockSizes[] = { 16, 32, 64, 128, 256, 512, 1024 };
+
+        HostState state;
+        state.sampleRate = sampleRates[random.nextInt(static_cast<int>(std::size(sampleRates)))];
+        state.numChannels = channelCounts[random.nextInt(static_cast<int>(std::size(channelCounts)))];
+        state.subBlockSize = subBlockSizes[random.nextInt(static_cast<int>(std::size(subBlockSizes)))];
+        state.announcedBlockSize = juce::jmax(1, getRandomBlockSize(random));
+        state.doublePrecision = random.nextBool();
+        state.path = random.nextBool() ? ProcessingPaths::VectorPath : ProcessingPaths::ReferencePath;
+        state.visualisation = static_cast<VisualisationModes>(random.nextInt(3));
+        return state;
+    }
+
+    // As a host restarts playback: release, pick the layout and precision,
+    // then prepare. Returns an error if the layout is refused.
+    juce::String prepare(TestDistortionAudioProcessor& processor, const HostState& state)
+    {
+        processor.releaseResources();
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(state.numChannels));
+        layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(state.numChannels));
+
+        if (! processor.setBusesLayout(layout))
+            return "layout refused";
+
+        processor.setProcessingPrecision(state.doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                               : juce::AudioProcessor::singlePrecision);
+        processor.setProcessingPath(state.path);
+        processor.setVisualisationMode(state.visualisation);
+        processor.setSubBlockSize(state.subBlockSize);
+        processor.setRateAndBufferSizeDetails(state.sampleRate, state.announcedBlockSize);
+        processor.prepareToPlay(state.sampleRate, state.announcedBlockSize);
+        return {};
+    }
+
+    template<typename SampleType>
+    void fillGuards(juce::AudioBuffer<SampleType>& storage, int numChannels, int numSamples)
+    {
+        auto guard = static_cast<SampleType>(guardValue);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            juce::FloatVectorOperations::fill(storage.getWritePointer(ch), guard, guardSamples);
+            juce::FloatVectorOperations::fill(storage.getWritePointer(ch, guardSamples + numSamples), guard, guardSamples);
+        }
+
+        juce::FloatVectorOperations::fill(storage.getWritePointer(numChannels), guard, numSamples + 2 * guardSamples);
+    }
+
+    template<typename SampleType>
+    juce::String findGuardWrite(const juce::AudioBuffer<SampleType>& storage, int numChannels, int numSamples)
+    {
+        auto check = [&storage](int ch, int start, int length) -> juce::String
+        {
+            auto* data = storage.getReadPointer(ch);
+            for (int i = start; i < start + length; ++i)
+                if (data[i] != static_cast<SampleType>(guardValue))
+                    return "write outside the buffer, channel " + juce::String(ch) + " sample " + juce::String(i - guardSamples);
+            return {};
+        };
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto before = check(ch, 0, guardSamples);
+            if (before.isNotEmpty())
+                return before;
+
+            auto after = check(ch, guardSamples + numSamples, guardSamples);
+            if (after.isNotEmpty())
+                return after;
+        }
+
+        return check(numChannels, 0, numSamples + 2 * guardSamples);
+    }
+
+    template<typename SampleType>
+    juce::String findBadSample(const juce::AudioBuffer<SampleType>& buffer)
+    {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            auto* data = buffer.getReadPointer(ch);
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                auto where = " on channel " + juce::String(ch) + " at sample " + juce::String(i);
+
+                if (! std::isfinite(data[i]))
+                    return (std::isnan(data[i]) ? "NaN" : "Inf") + where;
+                if (data[i] != 0 && std::abs(data[i]) < std::numeric_limits<SampleType>::min())
+                    return "denormal" + where;
+            }
+        }
+
+        return {};
+    }
+
+    // Runs one block through a view into the middle of storage, so that
+    // anything written past the block's edges, or to a channel the layout
+    // doesn't have, lands on a guard.
+    template<typename SampleType>
+    BlockResult runBlock(TestDistortionAudioProcessor& processor, juce::AudioBuffer<SampleType>& storage,
+                         int numChannels, int numSamples, float gain, juce::Random& random)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        fillGuards(storage, numChannels, numSamples);
+
+        juce::AudioBuffer<SampleType> view(storage.getArrayOfWritePointers(), numChannels, guardSamples, numSamples);
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* data = view.getWritePointer(ch);
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = static_cast<SampleType>(gain * (random.nextFloat() * 2.f - 1.f));
+        }
+
+        juce::MidiBuffer midi;
+        BlockResult result;
+
+        auto allocationsBefore = AllocationTracker::getNumRealtimeAllocations();
+        auto start = Clock::now();
+        processor.processBlock(view, midi);
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        result.allocations = AllocationTracker::getNumRealtimeAllocations() - allocationsBefore;
+
+        result.failure = findBadSample(view);
+        if (result.failure.isEmpty())
+            result.failure = findGuardWrite(storage, numChannels, numSamples);
+        if (result.failure.isEmpty() && result.allocations > 0)
+            result.failure = juce::String(result.allocations) + " allocations";
+
+        return result;
+    }
+
+   #if TESTDISTORTION_TRACK_ALLOCATIONS
+    // One block with a deliberate AudioBuffer inside processBlock, which the
+    // guard has to see; otherwise a run with no allocations proves nothing.
+    juce::String checkAllocationGuard(TestDistortionAudioProcessor& processor, juce::AudioBuffer<float>& storage)
+    {
+        HostState state;
+        auto error = prepare(processor, state);
+        if (error.isNotEmpty())
+            return error;
+
+        juce::Random random(0);
+        processor.allocateInNextBlock();
+        auto result = runBlock(processor, storage, state.numChannels, state.announcedBlockSize, 0.5f, random);
+
+        return result.allocations > 0 ? juce::String() : juce::String("the allocation guard missed an AudioBuffer built inside processBlock");
+    }
+   #endif
+
+    // Moves random parameters to random values as fast as it can, with the
+    // odd program change, the way a host plays back dense automation.
+    struct AutomationThread
+    {
+        AutomationThread(TestDistortionAudioProcessor& processorToUse, juce::int64 seed) :
+            processor(processorToUse),
+            random(seed)
+        {
+            thread = std::thread([this] { run(); });
+        }
+
+        ~AutomationThread()
+        {
+            running.store(false);
+            thread.join();
+        }
+
+        juce::int64 getNumChanges() const noexcept { return numChanges.load(); }
+
+    private:
+        void run()
+        {
+            auto& parameters = processor.getParameters();
+
+            while (running.load())
+            {
+                if (random.nextInt(1000) == 0)
+                    processor.setCurrentProgram(random.nextInt(processor.getNumPrograms()));
+                else
+                    parameters[random.nextInt(parameters.size())]->setValueNotifyingHost(random.nextFloat());
+
+                numChanges.fetch_add(1);
+
+                // Bursts with short gaps between them.
+                if (random.nextInt(64) == 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds(random.nextInt(500)));
+            }
+        }
+
+        TestDistortionAudioProcessor& processor;
+        juce::Random random;
+        std::atomic<bool> running{ true };
+        std::atomic<juce::int64> numChanges{ 0 };
+        std::thread thread;
+    };
+}
+
+//==============================================================================
+int runStressTest(const StressOptions& options)
+{
+    std::cout << "Stress test: " << options.numBlocks << " blocks, seed " << options.seed << std::endl;
+
+    AllocationTracker::setAbortOnRealtimeAllocation(false);
+
+    juce::Random random(options.seed);
+    TestDistortionAudioProcessor processor;
+
+    // Room for the widest layout and the longest block, plus the guards.
+    // processBlock only ever sees a view into the middle.
+    juce::AudioBuffer<float> floatStorage(maxChannels + 1, maxBlockSize + 2 * guardSamples);
+    juce::AudioBuffer<double> doubleStorage(maxChannels + 1, maxBlockSize + 2 * guardSamples);
+
+    HostState state;
+    int blocksSincePrepare = 0, silentBlocksLeft = 0;
+    int numFailures = 0, firstFailure = -1, numPrepares = 0, numTimingOutliers = 0;
+    juce::int64 numSamplesProcessed = 0, numAllocations = 0;
+    double worstLoad = 0;
+
+    auto report = [&state](int block, int numSamples, const juce::String& message)
+    {
+        std::cout << "  block " << block << " (" << numSamples << " samples; " << state.describe() << "): "
+                  << message << std::endl;
+    };
+
+   #if TESTDISTORTION_TRACK_ALLOCATIONS
+    auto guardError = checkAllocationGuard(processor, floatStorage);
+    if (guardError.isEmpty())
+    {
+        std::cout << "Allocation guard fires on an AudioBuffer built inside processBlock\n";
+    }
+    else
+    {
+        std::cout << "Failed: " << guardError << "\n";
+        ++numFailures;
+    }
+   #endif
+
+    // Declared after the processor, so it stops before the processor goes.
+    AutomationThread automation(processor, options.seed + 1);
+
+    for (int block = 0; block < options.numBlocks; ++block)
+    {
+        // Every so often the host stops and starts again with other settings.
+        if (block == 0 || random.nextInt(250) == 0)
+        {
+            state = makeRandomHostState(random);
+            auto error = prepare(processor, state);
+            blocksSincePrepare = 0;
+            ++numPrepares;
+
+            if (error.isNotEmpty())
+            {
+                if (++numFailures <= maxPrintedBlocks)
+                    report(block, 0, error);
+                if (firstFailure < 0)
+                    firstFailure = block;
+                continue;
+            }
+        }
+
+        // Switches the editor can make during playback.
+        if (random.nextInt(100) == 0)
+        {
+            state.path = random.nextBool() ? ProcessingPaths::VectorPath : ProcessingPaths::ReferencePath;
+            processor.setProcessingPath(state.path);
+        }
+        if (random.nextInt(100) == 0)
+        {
+            state.visualisation = static_cast<VisualisationModes>(random.nextInt(3));
+            processor.setVisualisationMode(state.visualisation);
+        }
+
+        // Runs of silence let the silence gate sleep and wake; otherwise
+        // noise anywhere from -100 to +20 dBFS.
+        if (silentBlocksLeft > 0)
+            --silentBlocksLeft;
+        else if (random.nextInt(40) == 0)
+            silentBlocksLeft = random.nextInt(200);
+
+        auto gain = silentBlocksLeft > 0 ? 0.f : juce::Decibels::decibelsToGain(random.nextFloat() * 120.f - 100.f);
+        auto numSamples = getRandomBlockSize(random);
+
+        auto result = state.doublePrecision ? runBlock(processor, doubleStorage, state.numChannels, numSamples, gain, random)
+                                            : runBlock(processor, floatStorage, state.numChannels, numSamples, gain, random);
+
+        numSamplesProcessed += numSamples;
+        numAllocations += result.allocations;
+
+        if (result.failure.isNotEmpty())
+        {
+            if (++numFailures <= maxPrintedBlocks)
+                report(block, numSamples, result.failure);
+            if (firstFailure < 0)
+                firstFailure = block;
+        }
+
+        // Against the block's own duration, which is all the time a host
+        // gives it. The OS can preempt any block, so these are listed
+        // rather than failed.
+        auto deadline = numSamples / state.sampleRate;
+        if (numSamples > 0 && blocksSincePrepare >= warmUpBlocks && result.seconds > options.maxLoad * deadline)
+        {
+            worstLoad = juce::jmax(worstLoad, result.seconds / deadline);
+            if (++numTimingOutliers <= maxPrintedBlocks)
+                report(block, numSamples, "took " + juce::String(100.0 * result.seconds / deadline, 0) + "% of its duration");
+        }
+
+        ++blocksSincePrepare;
+    }
+
+    processor.releaseResources();
+
+    std::cout << "\n" << options.numBlocks << " blocks, " << numSamplesProcessed << " samples, "
+              << numPrepares << " prepares, " << automation.getNumChanges() << " automation changes\n";
+
+   #if TESTDISTORTION_TRACK_ALLOCATIONS
+    std::cout << "Allocations inside processBlock: " << numAllocations << "\n";
+   #else
+    juce::ignoreUnused(numAllocations);
+    std::cout << "Allocations not checked; build with TESTDISTORTION_TRACK_ALLOCATIONS=1 (the Debug configuration does)\n";
+   #endif
+
+    std::cout << "Timing outliers over " << juce::String(100.0 * options.maxLoad, 0) << "% load: " << numTimingOutliers;
+    if (numTimingOutliers > 0)
+        std::cout << ", worst " << juce::String(100.0 * worstLoad, 0) << "%";
+    std::cout << "\n";
+
+    if (numFailures == 0)
+        std::cout << "No failures." << std::endl;
+    else if (firstFailure < 0)
+        std::cout << numFailures << " failures." << std::endl;
+    else
+        std::cout << numFailures << " failed blocks. Reproduce the first with:\n"
+                  << "  Benchmark --stress --seed " << options.seed << " --blocks " << firstFailure + 1 << std::endl;
+
+    return numFailures;
+}
@@ -0,0 +1,32 @@
+/*
+  ==============================================================================
+
+    StressTest.h
+
+    The --stress mode: drives processBlock the way a careless host might,
+    with random block sizes, re-preparing at other rates, layouts and
+    precisions, and parameters automated from another thread, and checks
+    every block it gets back.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct StressOptions
+{
+    juce::int64 seed = 0;
+    int numBlocks = 20000;
+
+    // Blocks that take longer than this share of their own duration are
+    // listed as timing outliers.
+    double maxLoad = 1.0;
+};
+
+// Returns the number of blocks that failed a check. The host's side of the
+// run follows from the seed alone, so a failure repeats with the same
+// --seed and a --blocks count that reaches it; only the interleaving with
+// the automation thread can differ.
+int runStressTest(const StressOptions& options);
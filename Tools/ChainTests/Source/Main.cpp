@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Checks that back up claims the processing code makes about itself:
+    that VectorChain renders what the per-channel MonoChain renders, that
+    the skewed cut cascade matches the serial one, and that the shared
+    lock-free structures hold up under concurrent use. The threaded tests
+    are most useful in a ThreadSanitizer build.
+
+    Runs every test in the "testDistortion" category and exits with 1 if
+    any of them failed.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList arguments(argc, argv);
+    if (arguments.containsOption("--help|-h"))
+    {
+        std::cout << "Usage: ChainTests [--seed <n>]\n";
+        return 0;
+    }
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+
+    if (arguments.containsOption("--seed"))
+        runner.runTestsInCategory("testDistortion", arguments.getValueForOption("--seed").getLargeIntValue());
+    else
+        runner.runTestsInCategory("testDistortion");
+
+    int numFailures = 0;
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        numFailures += runner.getResult(i)->failures;
+
+    std::cout << (numFailures == 0 ? juce::String("All tests passed.") : juce::String(numFailures) + " failures.") << std::endl;
+    return numFailures > 0 ? 1 : 0;
+}
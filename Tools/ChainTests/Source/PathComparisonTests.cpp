@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    PathComparisonTests.cpp
+
+    Renders the same signal through processBlock on the vector path and on
+    the per-channel reference path, for every curve, accuracy tier, slope
+    and bypass combination, and checks the outputs agree.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include <cmath>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr int numSamples = 1 << 13;
+
+    // Both paths run the same filters and curves in float, in a different
+    // order of operations, so anything above rounding noise is a bug.
+    constexpr float maxDifference = 1.0e-4f;
+
+    void setParameter(juce::AudioProcessorValueTreeState& apvts, const juce::String& id, float value)
+    {
+        auto* parameter = apvts.getParameter(id);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    void configure(TestDistortionAudioProcessor& processor, DistTypes distType, AccuracyTiers tier, FilterSlopes slope, int bypassBits)
+    {
+        auto& apvts = processor.apvts;
+        setParameter(apvts, "LowCut Freq", 120.f);
+        setParameter(apvts, "HighCut Freq", 9000.f);
+        setParameter(apvts, "LowCut Slope", static_cast<float>(slope));
+        setParameter(apvts, "HighCut Slope", static_cast<float>(slope));
+        setParameter(apvts, "Input Gain", 12.f);
+        setParameter(apvts, "Output Gain", -6.f);
+        setParameter(apvts, "Distortion Type", static_cast<float>(distType));
+        setParameter(apvts, "Curve Accuracy", static_cast<float>(tier));
+        setParameter(apvts, "LowCut Bypassed", (bypassBits & 1) != 0 ? 1.f : 0.f);
+        setParameter(apvts, "HighCut Bypassed", (bypassBits & 2) != 0 ? 1.f : 0.f);
+        setParameter(apvts, "Distortion Bypassed", (bypassBits & 4) != 0 ? 1.f : 0.f);
+    }
+
+    // Two partials an octave and a bit apart, with a little noise, and a
+    // different phase on each channel.
+    void fillTestSignal(juce::AudioBuffer<float>& buffer)
+    {
+        juce::Random random(0x5eed);
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            auto* data = buffer.getWritePointer(ch);
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                auto t = i / sampleRate;
+                data[i] = 0.4f * std::sin(static_cast<float>(juce::MathConstants<double>::twoPi * 110.0 * t))
+                        + 0.2f * std::sin(static_cast<float>(juce::MathConstants<double>::twoPi * 1730.0 * t + ch))
+                        + 0.05f * (random.nextFloat() * 2.f - 1.f);
+            }
+        }
+    }
+
+    void render(TestDistortionAudioProcessor& processor, juce::AudioBuffer<float>& buffer)
+    {
+        juce::MidiBuffer midi;
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        for (int start = 0; start < buffer.getNumSamples(); start += blockSize)
+        {
+            auto length = juce::jmin(blockSize, buffer.getNumSamples() - start);
+            juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, length);
+            processor.processBlock(block, midi);
+        }
+
+        processor.releaseResources();
+    }
+
+    float getMaxDifference(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        auto difference = 0.f;
+        for (int ch = 0; ch < a.getNumChannels(); ++ch)
+            for (int i = 0; i < a.getNumSamples(); ++i)
+                difference = juce::jmax(difference, std::abs(a.getSample(ch, i) - b.getSample(ch, i)));
+        return difference;
+    }
+}
+
+struct PathComparisonTests : juce::UnitTest
+{
+    PathComparisonTests() : juce::UnitTest("Vector path against reference path", "testDistortion") {}
+
+    void runTest() override
+    {
+        static const char* distNames[] = { "ArcTan", "HypTan", "Cubic", "Pow5", "Pow7", "Hard", "Custom" };
+        static const char* tierNames[] = { "draft", "standard", "exact" };
+
+        TestDistortionAudioProcessor vectorProcessor, referenceProcessor;
+        vectorProcessor.setProcessingPath(ProcessingPaths::VectorPath);
+        referenceProcessor.setProcessingPath(ProcessingPaths::ReferencePath);
+
+        juce::AudioBuffer<float> input(2, numSamples), vectorOutput, referenceOutput;
+        fillTestSignal(input);
+
+        for (int type = DistTypes::ArcTan; type <= DistTypes::Custom; ++type)
+        {
+            beginTest(distNames[type]);
+
+            for (int tier = AccuracyTiers::DraftTier; tier <= AccuracyTiers::ExactTier; ++tier)
+            {
+                for (int slope = FilterSlopes::Slope6; slope <= FilterSlopes::Slope48; ++slope)
+                {
+                    for (int bypassBits = 0; bypassBits < 8; ++bypassBits)
+                    {
+                        auto distType = static_cast<DistTypes>(type);
+                        auto accuracyTier = static_cast<AccuracyTiers>(tier);
+                        auto filterSlope = static_cast<FilterSlopes>(slope);
+
+                        configure(vectorProcessor, distType, accuracyTier, filterSlope, bypassBits);
+                        configure(referenceProcessor, distType, accuracyTier, filterSlope, bypassBits);
+
+                        vectorOutput.makeCopyOf(input);
+                        referenceOutput.makeCopyOf(input);
+                        render(vectorProcessor, vectorOutput);
+                        render(referenceProcessor, referenceOutput);
+
+                        auto difference = getMaxDifference(vectorOutput, referenceOutput);
+                        expect(difference <= maxDifference,
+                               juce::String(distNames[type]) + "/" + tierNames[tier] + "/" + juce::String(6 * (slope + 1)) + "dB"
+                               + "/bypass " + juce::String(bypassBits) + ": paths differ by " + juce::String(difference));
+                    }
+                }
+            }
+        }
+    }
+};
+
+static PathComparisonTests pathComparisonTests;
@@ -0,0 +1,190 @@
+/*
+  ==============================================================================
+
+    SampleRingTests.cpp
+
+    A writer thread pushes a counting sequence through a SampleRing in
+    uneven blocks while the reader drains it, now and then too slowly, and
+    then the ring is prepared over and over while the reader keeps going.
+    Run it under ThreadSanitizer or AddressSanitizer to check the ring for
+    races and stray accesses.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/SampleRing.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Counts stay exact in float well past this.
+    constexpr int totalSamples = 1 << 22;
+    constexpr int capacity = 1024;
+    constexpr int maxWriteSize = 300;
+
+    constexpr int numPrepares = 500;
+    constexpr int maxCapacity = 4096;
+}
+
+struct SampleRingTests : juce::UnitTest
+{
+    SampleRingTests() : juce::UnitTest("Sample ring counting sequence", "testDistortion") {}
+
+    void runTest() override
+    {
+        beginTest("One writer, one reader");
+        checkCountingSequence();
+
+        beginTest("Prepare while the reader is running");
+        checkPrepareWhileReading();
+    }
+
+private:
+    void checkCountingSequence()
+    {
+
+        SampleRing ring;
+        ring.prepare(capacity);
+        ring.attachReader();
+
+        std::atomic<bool> writing{ true };
+        auto writerSeed = getRandom().nextInt64();
+
+        std::thread writer([&ring, &writing, writerSeed]
+        {
+            juce::Random random(writerSeed);
+            std::vector<float> block(maxWriteSize);
+            int next = 0;
+
+            while (next < totalSamples)
+            {
+                auto size = juce::jmin(1 + random.nextInt(maxWriteSize), totalSamples - next);
+                for (int i = 0; i < size; ++i)
+                    block[static_cast<size_t>(i)] = static_cast<float>(next + i);
+
+                ring.write(block.data(), size);
+                next += size;
+            }
+
+            writing.store(false);
+        });
+
+        auto random = getRandom();
+        juce::int64 expected = 0, numRead = 0, numSkipped = 0, numOutOfOrder = 0;
+
+        auto check = [&](const float* data, int size)
+        {
+            for (int i = 0; i < size; ++i)
+            {
+                auto value = static_cast<juce::int64>(data[i]);
+                if (value < expected)
+                    ++numOutOfOrder;
+                else
+                    numSkipped += value - expected;
+
+                expected = value + 1;
+            }
+
+            numRead += size;
+        };
+
+        auto drain = [&]
+        {
+            auto spans = ring.getReadableSpans();
+            check(spans.first, spans.firstSize);
+            check(spans.second, spans.secondSize);
+            ring.finishedReading(spans.getTotalSize());
+        };
+
+        while (writing.load())
+        {
+            drain();
+
+            // Falls behind every so often, so the ring overflows.
+            if (random.nextInt(8) == 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(random.nextInt(200)));
+        }
+
+        writer.join();
+        drain();
+        numSkipped += totalSamples - expected;
+
+        expectEquals(numOutOfOrder, static_cast<juce::int64>(0), "samples read out of order");
+        expectEquals(numRead + numSkipped, static_cast<juce::int64>(totalSamples));
+        expectEquals(numSkipped, static_cast<juce::int64>(ring.getNumDroppedSamples()), "gaps that weren't counted as dropped");
+
+        ring.detachReader();
+    }
+
+    // As the plugin does it: prepare() and write() take turns on one
+    // thread, while the reader polls on another.
+    void checkPrepareWhileReading()
+    {
+        SampleRing ring;
+        ring.prepare(capacity);
+        ring.attachReader();
+
+        std::atomic<bool> writing{ true };
+        std::atomic<int> numOutOfOrder{ 0 }, numOversized{ 0 };
+
+        std::thread reader([&ring, &writing, &numOutOfOrder, &numOversized]
+        {
+            auto last = -1.f;
+
+            auto check = [&](const float* data, int size)
+            {
+                for (int i = 0; i < size; ++i)
+                {
+                    // A fresh, zeroed buffer read too far would go backwards.
+                    if (data[i] <= last)
+                        numOutOfOrder.fetch_add(1);
+
+                    last = data[i];
+                }
+            };
+
+            while (writing.load())
+            {
+                auto spans = ring.getReadableSpans();
+                if (spans.getTotalSize() > maxCapacity)
+                    numOversized.fetch_add(1);
+
+                check(spans.first, spans.firstSize);
+                check(spans.second, spans.secondSize);
+                ring.finishedReading(spans.getTotalSize());
+            }
+        });
+
+        auto random = getRandom();
+        std::vector<float> block(maxWriteSize);
+        int next = 1;
+
+        for (int round = 0; round < numPrepares; ++round)
+        {
+            ring.prepare(64 + random.nextInt(maxCapacity - 63));
+
+            for (int write = random.nextInt(20); --write >= 0;)
+            {
+                auto size = 1 + random.nextInt(maxWriteSize);
+                for (int i = 0; i < size; ++i)
+                    block[static_cast<size_t>(i)] = static_cast<float>(next++);
+
+                ring.write(block.data(), size);
+            }
+        }
+
+        writing.store(false);
+        reader.join();
+
+        expectEquals(numOutOfOrder.load(), 0, "samples read from a stale or fresh buffer");
+        expectEquals(numOversized.load(), 0, "spans larger than the ring");
+
+        ring.detachReader();
+    }
+};
+
+static SampleRingTests sampleRingTests;
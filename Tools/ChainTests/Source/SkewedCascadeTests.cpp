@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    SkewedCascadeTests.cpp
+
+    Checks that the skewed SIMD pipeline the float cut filters use gives
+    the same samples as running the sections one after another, at every
+    slope, with steady and gliding cutoffs and uneven block sizes.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/TptFilter.h"
+#include <array>
+#include <cmath>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int maxBlockSize = 512;
+
+    // Includes single samples and blocks shorter than the pipeline.
+    constexpr std::array<int, 8> blockSizes{ 512, 1, 3, 64, 7, 300, 2, 129 };
+}
+
+struct SkewedCascadeTests : juce::UnitTest
+{
+    SkewedCascadeTests() : juce::UnitTest("Skewed cascade against serial cascade", "testDistortion") {}
+
+    void runTest() override
+    {
+        beginTest("Low cut");
+        checkAllSlopes<CutFilterTypes::HighPassCut>();
+
+        beginTest("High cut");
+        checkAllSlopes<CutFilterTypes::LowPassCut>();
+    }
+
+private:
+    template<CutFilterTypes type>
+    void checkAllSlopes()
+    {
+        for (int slope = FilterSlopes::Slope6; slope <= FilterSlopes::Slope48; ++slope)
+        {
+            auto filterSlope = static_cast<FilterSlopes>(slope);
+            auto layout = CutSlopeLayout::forSlope(filterSlope);
+
+            SkewedSvfCascade skewed;
+            skewed.prepare(maxBlockSize);
+            skewed.setLayout(layout);
+            TptOnePole<float> onePole;
+
+            TptCutCascade<float> serial;
+            serial.setSlope(filterSlope);
+
+            CutoffSmoother<float> smoother;
+            smoother.prepare(sampleRate, maxBlockSize);
+            smoother.setCutoffFrequency(1000.f);
+            smoother.reset();
+
+            auto random = getRandom();
+            std::array<float, maxBlockSize> skewedData, serialData;
+            auto difference = 0.f;
+
+            for (int block = 0; block < 64; ++block)
+            {
+                // Every few blocks the cutoff starts a new glide, so some
+                // blocks run on a per-sample ramp and some on a steady g.
+                if (block % 6 == 0)
+                    smoother.setCutoffFrequency(20.f * std::pow(1000.f, random.nextFloat()));
+
+                auto numSamples = blockSizes[static_cast<size_t>(block) % blockSizes.size()];
+                for (int i = 0; i < numSamples; ++i)
+                    skewedData[static_cast<size_t>(i)] = serialData[static_cast<size_t>(i)] = random.nextFloat() * 2.f - 1.f;
+
+                auto* ramp = smoother.getNextRamp(numSamples);
+                auto gain = smoother.getCurrentGain();
+                auto length = static_cast<size_t>(numSamples);
+
+                if (layout.hasOnePole)
+                    onePole.template process<type>(skewedData.data(), length, ramp, gain);
+                skewed.template process<type>(skewedData.data(), length, ramp, gain);
+                serial.template process<type>(serialData.data(), length, ramp, gain);
+
+                for (size_t i = 0; i < length; ++i)
+                    difference = juce::jmax(difference, std::abs(skewedData[i] - serialData[i]));
+            }
+
+            expectEquals(difference, 0.f, juce::String(6 * (slope + 1)) + " dB/oct");
+        }
+    }
+};
+
+static SkewedCascadeTests skewedCascadeTests;
@@ -0,0 +1,357 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Headless renderer: runs TestDistortionAudioProcessor over WAV/AIFF files
+    faster than real time, one processor per worker thread.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct RenderOptions
+    {
+        juce::Array<juce::File> inputs;
+        juce::File outputDirectory;
+        juce::File stateFile;
+        juce::StringPairArray parameters;
+        int blockSize = 8192;
+        int numThreads = juce::SystemStats::getNumCpus();
+        bool useReferencePath = false;
+    };
+
+    struct RenderResult
+    {
+        juce::File input;
+        juce::String error;
+        juce::int64 numFrames = 0;
+        int numChannels = 0;
+        double sampleRate = 0;
+        double processSeconds = 0;
+        double wallSeconds = 0;
+        double asleepShare = 0;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: OfflineRender [options] <input file>...\n"
+                     "\n"
+                     "  --output-dir <dir>      Where rendered files go (default: next to each input)\n"
+                     "  --state <file>          Plugin state saved by getStateInformation(), or its XML\n"
+                     "  --param <name>=<value>  Parameter value as the plugin displays it, e.g.\n"
+                     "                          --param \"Input Gain=12\" --param \"Distortion Type=Hard\"\n"
+                     "  --block-size <n>        Samples per processBlock call (default 8192)\n"
+                     "  --threads <n>           Worker threads (default: number of CPUs)\n"
+                     "  --reference             Use the per-channel reference path\n"
+                     "\n"
+                     "Parameters: ";
+
+        TestDistortionAudioProcessor processor;
+        juce::StringArray names;
+        for (auto* parameter : processor.getParameters())
+            names.add(parameter->getName(100));
+        std::cout << names.joinIntoString(", ") << std::endl;
+    }
+
+    bool parseArguments(const juce::ArgumentList& args, RenderOptions& options)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            auto arg = args[i].text;
+            auto hasValue = i + 1 < args.size();
+
+            if (arg == "--output-dir" && hasValue)
+                options.outputDirectory = args[++i].resolveAsFile();
+            else if (arg == "--state" && hasValue)
+                options.stateFile = args[++i].resolveAsFile();
+            else if (arg == "--param" && hasValue)
+            {
+                auto pair = args[++i].text;
+                if (! pair.contains("="))
+                {
+                    std::cerr << "Expected <name>=<value>, got: " << pair << std::endl;
+                    return false;
+                }
+                options.parameters.set(pair.upToFirstOccurrenceOf("=", false, false).trim(),
+                    pair.fromFirstOccurrenceOf("=", false, false).trim());
+            }
+            else if (arg == "--block-size" && hasValue)
+                options.blockSize = juce::jmax(1, args[++i].text.getIntValue());
+            else if (arg == "--threads" && hasValue)
+                options.numThreads = juce::jmax(1, args[++i].text.getIntValue());
+            else if (arg == "--reference")
+                options.useReferencePath = true;
+            else if (arg.startsWith("--"))
+            {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                return false;
+            }
+            else
+                options.inputs.add(args[i].resolveAsFile());
+        }
+
+        return ! options.inputs.isEmpty();
+    }
+
+    // Applies the state file and the --param values. Returns an error
+    // message, or an empty string on success.
+    juce::String configureProcessor(TestDistortionAudioProcessor& processor, const RenderOptions& options)
+    {
+        if (options.stateFile != juce::File())
+        {
+            juce::MemoryBlock state;
+            if (! options.stateFile.loadFileAsData(state))
+                return "Could not read state file " + options.stateFile.getFullPathName();
+
+            if (auto xml = juce::parseXML(state.toString()))
+            {
+                juce::MemoryBlock binary;
+                juce::MemoryOutputStream stream(binary, false);
+                juce::ValueTree::fromXml(*xml).writeToStream(stream);
+                stream.flush();
+                processor.setStateInformation(binary.getData(), static_cast<int>(binary.getSize()));
+            }
+            else
+                processor.setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+        }
+
+        for (auto& name : options.parameters.getAllKeys())
+        {
+            auto* parameter = processor.apvts.getParameter(name);
+            if (parameter == nullptr)
+                return "Unknown parameter: " + name;
+
+            auto text = options.parameters[name];
+            parameter->setValueNotifyingHost(parameter->getValueForText(text));
+        }
+
+        processor.setProcessingPath(options.useReferencePath ? ProcessingPaths::ReferencePath
+                                                             : ProcessingPaths::VectorPath);
+        processor.setNonRealtime(true);
+        return {};
+    }
+
+    juce::File getOutputFile(const juce::File& input, const RenderOptions& options)
+    {
+        auto name = input.getFileNameWithoutExtension() + "_rendered" + input.getFileExtension();
+        auto directory = options.outputDirectory != juce::File() ? options.outputDirectory
+                                                                 : input.getParentDirectory();
+        return directory.getChildFile(name);
+    }
+
+    // Streams one file through the processor, with the main bus set to the
+    // file's channel count. The shaper's latency is compensated by feeding extra silence and
+    // dropping that many samples from the start of the output.
+    RenderResult renderFile(TestDistortionAudioProcessor& processor,
+                            juce::AudioFormatManager& formatManager,
+                            const juce::File& input,
+                            const RenderOptions& options)
+    {
+        using Clock = std::chrono::steady_clock;
+        auto wallStart = Clock::now();
+
+        RenderResult result;
+        result.input = input;
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(input));
+        if (reader == nullptr)
+        {
+            result.error = "Not a readable WAV/AIFF file";
+            return result;
+        }
+
+        result.numChannels = static_cast<int>(reader->numChannels);
+        result.sampleRate = reader->sampleRate;
+        result.numFrames = reader->lengthInSamples;
+
+        auto channelSet = juce::AudioChannelSet::canonicalChannelSet(result.numChannels);
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(channelSet);
+        layout.outputBuses.add(channelSet);
+
+        if (result.numChannels < 1 || ! processor.setBusesLayout(layout))
+        {
+            result.error = "Unsupported channel count: " + juce::String(result.numChannels);
+            return result;
+        }
+
+        auto* format = formatManager.findFormatForFileExtension(input.getFileExtension());
+        auto outputFile = getOutputFile(input, options);
+        if (format == nullptr || outputFile == input)
+        {
+            result.error = "Cannot write " + outputFile.getFullPathName();
+            return result;
+        }
+
+        outputFile.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream(outputFile.createOutputStream());
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        if (stream != nullptr)
+            writer.reset(format->createWriterFor(stream.get(), reader->sampleRate,
+                static_cast<unsigned int>(result.numChannels), static_cast<int>(reader->bitsPerSample),
+                reader->metadataValues, 0));
+
+        if (writer == nullptr)
+        {
+            result.error = "Could not create " + outputFile.getFullPathName();
+            return result;
+        }
+        stream.release(); // the writer owns it now
+
+        auto blockSize = options.blockSize;
+        processor.releaseResources();
+        processor.setRateAndBufferSizeDetails(reader->sampleRate, blockSize);
+        processor.prepareToPlay(reader->sampleRate, blockSize);
+
+        auto latency = static_cast<juce::int64>(processor.getLatencySamples());
+        auto totalFrames = result.numFrames + latency;
+
+        juce::AudioBuffer<float> buffer(result.numChannels, blockSize);
+        juce::MidiBuffer midi;
+        double processSeconds = 0;
+
+        for (juce::int64 position = 0; position < totalFrames; position += blockSize)
+        {
+            auto numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(blockSize), totalFrames - position));
+            buffer.setSize(result.numChannels, numSamples, false, false, true);
+
+            // Reads past the end of the file are filled with silence.
+            reader->read(&buffer, 0, numSamples, position, true, true);
+
+            auto processStart = Clock::now();
+            processor.processBlock(buffer, midi);
+            processSeconds += std::chrono::duration<double>(Clock::now() - processStart).count();
+
+            auto skip = juce::jlimit(static_cast<juce::int64>(0), static_cast<juce::int64>(numSamples), latency - position);
+            if (skip < numSamples)
+                writer->writeFromAudioSampleBuffer(buffer, static_cast<int>(skip), numSamples - static_cast<int>(skip));
+        }
+
+        writer.reset();
+
+        const auto& gate = processor.getSilenceGate();
+        if (gate.getNumSamplesSeen() > 0)
+            result.asleepShare = static_cast<double>(gate.getNumSamplesAsleep()) / static_cast<double>(gate.getNumSamplesSeen());
+
+        processor.releaseResources();
+
+        result.processSeconds = processSeconds;
+        result.wallSeconds = std::chrono::duration<double>(Clock::now() - wallStart).count();
+        return result;
+    }
+
+    void printResult(const RenderResult& result)
+    {
+        if (result.error.isNotEmpty())
+        {
+            std::cerr << result.input.getFileName() << ": " << result.error << std::endl;
+            return;
+        }
+
+        auto audioSeconds = result.numFrames / result.sampleRate;
+        std::cout << result.input.getFileName()
+                  << ": " << result.numFrames << " frames x " << result.numChannels << " ch"
+                  << ", processing " << juce::String(result.numFrames / result.processSeconds / 1.0e6, 2) << " M frames/s"
+                  << " (" << juce::String(audioSeconds / result.processSeconds, 1) << "x real time)"
+                  << ", with file I/O " << juce::String(audioSeconds / result.wallSeconds, 1) << "x real time"
+                  << ", asleep " << juce::String(100.0 * result.asleepShare, 1) << "%"
+                  << std::endl;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args(argc, argv);
+    RenderOptions options;
+
+    if (! parseArguments(args, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (options.outputDirectory != juce::File() && ! options.outputDirectory.createDirectory())
+    {
+        std::cerr << "Could not create " << options.outputDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    auto numWorkers = juce::jmin(options.numThreads, options.inputs.size());
+
+    // Processors are created and configured here, on the message thread,
+    // and each worker then has exclusive use of one.
+    std::vector<std::unique_ptr<TestDistortionAudioProcessor>> processors;
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto processor = std::make_unique<TestDistortionAudioProcessor>();
+        auto error = configureProcessor(*processor, options);
+        if (error.isNotEmpty())
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        processors.push_back(std::move(processor));
+    }
+
+    std::vector<RenderResult> results(static_cast<size_t>(options.inputs.size()));
+    std::atomic<int> nextInput{ 0 };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (auto& processor : processors)
+    {
+        workers.emplace_back([&, p = processor.get()]
+        {
+            juce::AudioFormatManager formatManager;
+            formatManager.registerFormat(new juce::WavAudioFormat(), true);
+            formatManager.registerFormat(new juce::AiffAudioFormat(), false);
+
+            for (int i = nextInput++; i < options.inputs.size(); i = nextInput++)
+                results[static_cast<size_t>(i)] = renderFile(*p, formatManager, options.inputs[i], options);
+        });
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    juce::int64 totalFrames = 0;
+    double totalAudioSeconds = 0;
+    int numFailed = 0;
+
+    for (auto& result : results)
+    {
+        printResult(result);
+
+        if (result.error.isNotEmpty())
+        {
+            ++numFailed;
+            continue;
+        }
+
+        totalFrames += result.numFrames;
+        totalAudioSeconds += result.numFrames / result.sampleRate;
+    }
+
+    std::cout << "\n" << (results.size() - static_cast<size_t>(numFailed)) << " file(s) on "
+              << numWorkers << " thread(s) in " << juce::String(elapsed, 2) << " s: "
+              << juce::String(totalFrames / elapsed / 1.0e6, 2) << " M frames/s, "
+              << juce::String(totalAudioSeconds / elapsed, 1) << "x real time" << std::endl;
+
+    return numFailed == 0 ? 0 : 1;
+}